@@ -0,0 +1,39 @@
+#include "Chip8_AOT.h"
+
+Chip8_AOT *aot_create(const Chip8_AOT_Program *program, Chip8_CPU *cpu)
+{
+    if (program->target != cpu->target || program->rom_size > memory_size(cpu) - 0x200 ||
+        memcmp(&cpu->game_memory[0x200], program->rom, program->rom_size) != 0)
+        return NULL;
+
+    Chip8_AOT *aot = calloc(1, sizeof(Chip8_AOT));
+    ASSERT((aot != NULL), "[ERROR] Can't allocate AOT block table.\n");
+    aot->program = program;
+
+    for (uint32_t i = 0; i < program->block_count; i++)
+    {
+        const Chip8_AOT_Block *block = &program->blocks[i];
+        aot->entries[block->address >> 1] = block;
+
+        // Decoded addresses reach invalidate_code when they are written to.
+        for (uint32_t address = block->address; address < block->end; address += 2)
+            predecode(cpu, address);
+    }
+
+    return aot;
+}
+
+void aot_destroy(Chip8_AOT *aot)
+{
+    free(aot);
+}
+
+void aot_invalidate(Chip8_AOT *aot, WORD address)
+{
+    for (uint32_t i = 0; i < aot->program->block_count; i++)
+    {
+        const Chip8_AOT_Block *block = &aot->program->blocks[i];
+        if (block->address <= address && address < block->end)
+            aot->entries[block->address >> 1] = NULL;
+    }
+}
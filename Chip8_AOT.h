@@ -0,0 +1,67 @@
+#ifndef CHIP8_AOT_H
+#define CHIP8_AOT_H 1
+
+#include "Chip8_CPU.h"
+
+/* Runtime side of ROMs compiled ahead of time by chip8-aot. The generated
+   translation unit holds one function per basic block reachable from 0x200
+   and describes them in a Chip8_AOT_Program. Addresses without a compiled
+   block (BNNN targets, odd addresses, overwritten code) run on the block
+   interpreter. */
+
+typedef void (*Chip8_AOT_Function)(Chip8_CPU *cpu);
+
+typedef struct
+{
+    WORD address;
+    WORD length;  // Instructions executed by `run`.
+    uint32_t end; // One past the last byte of the block.
+    Chip8_AOT_Function run;
+} Chip8_AOT_Block;
+
+typedef struct
+{
+    Target_Platform target;
+    const BYTE *rom;
+    uint32_t rom_size;
+    const Chip8_AOT_Block *blocks;
+    uint32_t block_count;
+} Chip8_AOT_Program;
+
+struct Chip8_AOT
+{
+    const Chip8_AOT_Program *program;
+    const Chip8_AOT_Block *entries[CHIP8_DECODE_CACHE_SIZE]; // Compiled block per even address, NULL if none.
+};
+
+// Returns NULL if the ROM loaded in `cpu` or its target differ from the ones the program was compiled from.
+Chip8_AOT *aot_create(const Chip8_AOT_Program *program, Chip8_CPU *cpu);
+
+void aot_destroy(Chip8_AOT *aot);
+
+/* CHIP-8 program chip8-rom -V runs before the ROM under -e AOT, compiled in
+   next to it by "make aot" (chip8-aot -k). It never writes to its own code,
+   so what it checks are the compiled blocks: 32 passes over ALU, skip, call,
+   draw, BCD and load/store instructions, then a jump to itself. */
+static const BYTE aot_check[] = {
+    0x6E, 0x20,                                                             // 0x200: 32 passes
+    0x70, 0x01, 0x71, 0x03, 0x80, 0x14, 0x82, 0x15, 0x83, 0x06, 0x81, 0x27, // 0x202: ALU
+    0x30, 0x00, 0x72, 0x01, 0x41, 0x00, 0x73, 0x02, 0x50, 0x10, 0x74, 0x01, // 0x20E: skips
+    0x91, 0x20, 0x75, 0x01,
+    0x8C, 0x04, 0x8C, 0x14, 0x8C, 0x24, 0x8C, 0x34,                         // 0x21E: sum V0-V3 in VC
+    0x22, 0x3C, 0xA2, 0x42, 0xD1, 0x24,                                     // 0x226: call, draw
+    0xA2, 0x46, 0xF3, 0x33, 0xF2, 0x65, 0xF7, 0x55,                         // 0x22C: BCD, load, store
+    0x7E, 0xFF, 0x3E, 0x00, 0x12, 0x02, 0x12, 0x3A,                         // 0x234: loop, then halt
+    0x7D, 0x01, 0x8D, 0x34, 0x00, 0xEE,                                     // 0x23C: subroutine
+    0x81, 0x42, 0x24, 0x18,                                                 // 0x242: sprite
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};                        // 0x246: data
+
+// Drops every compiled block that covers `address`.
+void aot_invalidate(Chip8_AOT *aot, WORD address);
+
+static inline const Chip8_AOT_Block *aot_lookup(const Chip8_AOT *aot, WORD address)
+{
+    return (address & 1) ? NULL : aot->entries[address >> 1];
+}
+
+#endif
@@ -1,151 +1,182 @@
 #include "Chip8_CPU.h"
+#include "Chip8_Interpreter.h"
 #include "Chip8_Instructions.h"
+#include "Chip8_Decode.h"
+#include "Chip8_JIT.h"
+#include "Chip8_AOT.h"
 
 
-void aux_0XXX(Chip8_CPU *cpu, WORD inst)
+void cpu_reset(Chip8_CPU *cpu)
 {
-    WORD aux = ((inst & 0x00E0) == 0x00C0) ? (inst & 0x00F0) : inst;
-    switch (aux & 0x00FF)
-    {
-    case (0x00C0): OP_00CN(cpu,inst); break;
-    case (0x00D0): OP_00DN(cpu,inst); break;
-    case (0x00E0): OP_00E0(cpu); break;
-    case (0x00EE): OP_00EE(cpu); break;
-    case (0x00FB): OP_00FB(cpu,inst); break;
-    case (0x00FC): OP_00FC(cpu,inst); break;
-    case (0x00FD): OP_00FD(cpu,inst); break;
-    case (0x00FE): OP_00FE(cpu,inst); break;
-    case (0x00FF): OP_00FF(cpu,inst); break;
-    default: OP_NULL(cpu, inst); break;
-    }
+    memset(cpu->game_memory, 0, sizeof(cpu->game_memory));
+    memset(cpu->game_registers, 0, sizeof(cpu->game_registers));
+    memset(cpu->screen_planes, 0, sizeof(cpu->screen_planes));
+    memset(cpu->screen_origins, 0, sizeof(cpu->screen_origins));
+    cpu->dirty_flag = 1;
+    memcpy(&cpu->game_memory[SMALL_FONT_ADDRESS], &small_font, sizeof(small_font));
+    memcpy(&cpu->game_memory[BIG_FONT_ADDRESS], &big_font, sizeof(big_font));
+    memcpy(&cpu->game_memory[memory_size(cpu)], cpu->game_memory, CHIP8_MEMORY_GUARD);
+    memset(cpu->decode_cache, 0, CHIP8_DECODE_CACHE_SIZE * sizeof(Chip8_Decoded));
+
+    reset_stack(&cpu->call_stack);
+    cpu->i_register = 0;
+    cpu->program_counter = 0x200;
+    cpu->pressed_key = 16;
+    cpu->random_state = 0x2545F491;
+    cpu->waiting_key = 0;
+    cpu->idle = 0;
+    cpu->executed_cycles = 0;
+    cpu->skipped_cycles = 0;
 }
 
-void aux_5XYN(Chip8_CPU *cpu, WORD inst)
+void (*cpu_exit_handler)(int status) = NULL;
+
+_Noreturn void cpu_exit(int status)
 {
-    switch ( inst & 0x000F)
-    {
-    case 0x0: OP_5XY0(cpu,inst); break;
-    case 0x2: OP_5XY2(cpu,inst); break;
-    case 0x3: OP_5XY3(cpu,inst); break;
-    default: OP_NULL(cpu,inst); break;
-    }
+    if (cpu_exit_handler != NULL)
+        cpu_exit_handler(status);
+    exit(status);
 }
 
-void aux_8XYN(Chip8_CPU *cpu, WORD inst)
+void init_cpu(Chip8_CPU *cpu, FILE *stream, Target_Platform target)
 {
-    switch ( inst & 0x000F)
+    if (cpu->decode_cache == NULL)
     {
-    case 0x0: OP_8XY0(cpu,inst); break;
-    case 0x1: OP_8XY1(cpu,inst); break;
-    case 0x2: OP_8XY2(cpu,inst); break;
-    case 0x3: OP_8XY3(cpu,inst); break;
-    case 0x4: OP_8XY4(cpu,inst); break;
-    case 0x5: OP_8XY5(cpu,inst); break;
-    case 0x6: OP_8XY6(cpu,inst); break;
-    case 0x7: OP_8XY7(cpu,inst); break;
-    case 0xe: OP_8XYE(cpu,inst); break;
-    default: OP_NULL(cpu,inst); break;
+        cpu->decode_cache = calloc(CHIP8_DECODE_CACHE_SIZE, sizeof(Chip8_Decoded));
+        ASSERT((cpu->decode_cache != NULL), "[ERROR] Can't allocate predecode cache.\n");
     }
-    
-}
 
-void aux_EXYN(Chip8_CPU *cpu, WORD inst)
-{   
-    switch (inst & 0x00FF)
+    cpu->target = target; // cpu_reset places the memory guard after the target's address space.
+    cpu_reset(cpu);
+    switch (target)
     {
-    case (0x009E): OP_EX9E(cpu, inst); break;
-    case (0x00A1): OP_EXA1(cpu, inst); break;
-    default: OP_NULL(cpu, inst); break;
+    case CHIP8: cpu->interpreter = &interpreter_CHIP8; break;
+    case SCHIPC: cpu->interpreter = &interpreter_SCHIPC; break;
+    default: cpu->interpreter = &interpreter_XOCHIP; break;
     }
+    cpu->mode = LORES;
+    cpu->bitplane = 1;
+    fread(&cpu->game_memory[0x200], sizeof(BYTE), memory_size(cpu) - 0x200, stream);
 }
 
-void aux_FXNN(Chip8_CPU *cpu, WORD inst)
+void free_cpu(Chip8_CPU *cpu)
 {
-    switch (inst & 0x00FF)
-    {
-    case 0x00: OP_F000(cpu, inst); break;
-    case 0x01: OP_FN01(cpu, inst); break;
-    case 0x02: OP_F002(cpu, inst); break;
-    case 0x07: OP_FX07(cpu, inst); break;
-    case 0x0A: OP_FX0A(cpu, inst); break;
-    case 0x15: OP_FX15(cpu, inst); break;
-    case 0x18: OP_FX18(cpu, inst); break;
-    case 0x1E: OP_FX1E(cpu, inst); break;
-    case 0x29: OP_FX29(cpu, inst); break;
-    case 0x30: OP_FX30(cpu, inst); break;
-    case 0x33: OP_FX33(cpu, inst); break;
-    case 0x3A: OP_FX3A(cpu, inst); break;
-    case 0x55: OP_FX55(cpu, inst); break;
-    case 0x65: OP_FX65(cpu, inst); break;
-    case 0x75: OP_FX75(cpu, inst); break;
-    case 0x85: OP_FX85(cpu, inst); break;
-    default: OP_NULL(cpu, inst); break;
-    }
+    free(cpu->decode_cache);
+    cpu->decode_cache = NULL;
+    jit_destroy(cpu->jit);
+    cpu->jit = NULL;
+    aot_destroy(cpu->aot);
+    cpu->aot = NULL;
 }
 
-void exec_instruction(Chip8_CPU *cpu)
-{   
-    WORD instruction = cpu->game_memory[cpu->program_counter++];
-    instruction <<= 8;
-    instruction |= cpu->game_memory[cpu->program_counter++];    
-    
-    switch ((instruction & 0xF000) >> 12)
-    {
-    case 0x0: aux_0XXX(cpu,instruction); break;
-    case 0x1: OP_1NNN(cpu,instruction); break;
-    case 0x2: OP_2NNN(cpu,instruction); break;
-    case 0x3: OP_3XNN(cpu,instruction); break;
-    case 0x4: OP_4XNN(cpu,instruction); break;
-    case 0x5: aux_5XYN(cpu,instruction); break;
-    case 0x6: OP_6XNN(cpu,instruction); break;
-    case 0x7: OP_7XNN(cpu,instruction); break;
-    case 0x8: aux_8XYN(cpu,instruction); break;
-    case 0x9: OP_9XY0(cpu,instruction); break;
-    case 0xa: OP_ANNN(cpu,instruction); break;
-    case 0xb: OP_BNNN(cpu,instruction); break;
-    case 0xc: OP_CXNN(cpu,instruction); break;
-    case 0xd: OP_DXYN(cpu,instruction); break;
-    case 0xe: aux_EXYN(cpu,instruction); break;
-    case 0xf: aux_FXNN(cpu,instruction); break;
-    default: OP_NULL(cpu,instruction); break;
-    }
+// Compares the architectural state of two CPUs, caches excluded.
+int cpu_state_equal(const Chip8_CPU *a, const Chip8_CPU *b)
+{
+    return memcmp(a->game_registers, b->game_registers, sizeof(a->game_registers)) == 0 &&
+           a->i_register == b->i_register &&
+           a->program_counter == b->program_counter &&
+           a->call_stack.n_elements == b->call_stack.n_elements &&
+           memcmp(a->call_stack.stack, b->call_stack.stack, sizeof(a->call_stack.stack)) == 0 &&
+           a->delay_timer == b->delay_timer &&
+           a->sound_timer == b->sound_timer &&
+           a->mode == b->mode &&
+           a->bitplane == b->bitplane &&
+           a->pressed_key == b->pressed_key &&
+           a->waiting_key == b->waiting_key &&
+           a->random_state == b->random_state &&
+           memcmp(a->keys, b->keys, sizeof(a->keys)) == 0 &&
+           memcmp(a->screen_planes, b->screen_planes, sizeof(a->screen_planes)) == 0 &&
+           memcmp(a->screen_origins, b->screen_origins, sizeof(a->screen_origins)) == 0 &&
+           memcmp(a->game_memory, b->game_memory, sizeof(a->game_memory)) == 0;
 }
 
-void cpu_reset(Chip8_CPU *cpu)
+/* Cache entry for the instruction at the even `address`, decoded on demand.
+   Anything derived from game_memory must read code through here so writes
+   to it reach invalidate_code. */
+const Chip8_Decoded *predecode(Chip8_CPU *cpu, WORD address)
 {
-    memset(cpu->game_memory, 0, sizeof(cpu->game_memory));
-    memset(cpu->game_registers, 0, sizeof(cpu->game_registers));
-    memset(cpu->screen_plane1, 0, sizeof(cpu->screen_plane1));
-    memset(cpu->screen_plane2, 0, sizeof(cpu->screen_plane2));
-    memcpy(&cpu->game_memory[SMALL_FONT_ADDRESS], &small_font, sizeof(small_font));
-    memcpy(&cpu->game_memory[BIG_FONT_ADDRESS], &big_font, sizeof(big_font));
-
-    reset_stack(&cpu->call_stack);
-    cpu->i_register = 0;
-    cpu->program_counter = 0x200;
-    cpu->pressed_key = 16;
+    address &= memory_size(cpu) - 1;
+    Chip8_Decoded *decoded = &cpu->decode_cache[address >> 1];
+    if (decoded->handler == NULL)
+        cpu->interpreter->decode(cpu, decoded, address);
+    return decoded;
 }
 
-void init_cpu(Chip8_CPU *cpu, FILE *stream, Target_Platform target)
+/* Drops the instruction at `address`, the superinstructions that include it,
+   every cached block that covers any of them and the cached skip right
+   before it, whose distance depends on it. */
+void invalidate_code(Chip8_CPU *cpu, WORD address)
 {
-    cpu_reset(cpu);
-    cpu->target = target;
-    cpu->mode = LORES;
-    cpu->bitplane = 1;
-    fread(&cpu->game_memory[0x200], sizeof(BYTE), XOCHIP_MEMSIZE, stream);
+    uint32_t index = address >> 1;
+    uint32_t lowest = index;
+    WORD previous = ((address & 0xFFFE) - 2) & (memory_size(cpu) - 1);
+
+    if (cpu->decode_cache[previous >> 1].skip != 0)
+        invalidate_code(cpu, previous);
+
+    for (uint32_t i = (index >= 2) ? index - 2 : 0; i < index; i++)
+    {
+        if (i + cpu->decode_cache[i].length > index)
+        {
+            cpu->decode_cache[i].handler = NULL;
+            cpu->decode_cache[i].op = ENTRY_UNDECODED;
+            lowest = (i < lowest) ? i : lowest;
+        }
+    }
+
+    uint32_t first = (lowest >= CHIP8_MAX_BLOCK_LENGTH - 1) ? lowest - (CHIP8_MAX_BLOCK_LENGTH - 1) : 0;
+
+    for (uint32_t i = first; i < index; i++)
+    {
+        if (i + cpu->decode_cache[i].block_length > lowest)
+            cpu->decode_cache[i].block_length = 0;
+    }
+
+    cpu->decode_cache[index].handler = NULL;
+    cpu->decode_cache[index].op = ENTRY_UNDECODED;
+    cpu->decode_cache[index].block_length = 0;
+    cpu->decode_cache[index].skip = 0;
+
+    /* Native code covering any entry dropped here goes too: with its handler
+       NULL, write_memory no longer reports later stores to that entry. */
+    for (uint32_t i = lowest; i <= index; i++)
+    {
+        if (cpu->jit != NULL)
+            jit_invalidate(cpu->jit, i << 1);
+        if (cpu->aot != NULL)
+            aot_invalidate(cpu->aot, i << 1);
+    }
 }
 
 void run_instructions(Chip8_CPU *cpu, uint32_t CPF)
 {
-    for (uint32_t i = 0; i < CPF; i++)
+    uint32_t executed;
+
+    if (cpu->waiting_key)
     {
-        //printf("0x%04x  0x%0x4\n",cpu->game_memory[cpu->program_counter-2],cpu->program_counter-2);
-        exec_instruction(cpu);
+        cpu->skipped_cycles += CPF;
+        return;
     }
+
+    if (cpu->profile != NULL)
+        executed = cpu->interpreter->run_profiled(cpu, CPF);
+    else
+        executed = cpu->interpreter->run[cpu->engine](cpu, CPF);
+
+    cpu->executed_cycles += executed;
+    cpu->skipped_cycles += CPF - executed;
+}
+
+// Updates the state of `key` and wakes a CPU blocked on FX0A.
+void cpu_key_event(Chip8_CPU *cpu, BYTE key, BYTE pressed)
+{
+    cpu->keys[key] = pressed;
+    cpu->waiting_key = 0;
 }
 
 void update_timers(Chip8_CPU *cpu)
 {
+    cpu->idle = 0;
     if (cpu->delay_timer > 0)
     {
         cpu->delay_timer--;
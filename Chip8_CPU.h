@@ -19,6 +19,25 @@
 #endif
 
 
+/* Ends the program from code that runs the CPU: 00FD and every failed
+   CPU_ASSERT. cpu_exit calls cpu_exit_handler if set, exit() otherwise. A
+   frontend running the CPU on its own thread sets it to stop that thread
+   and leave exit() to the main one. The handler must not return. */
+extern void (*cpu_exit_handler)(int status);
+
+_Noreturn void cpu_exit(int status);
+
+#define CPU_ASSERT(_bool, ...)            \
+    do                                    \
+    {                                     \
+        if (!(_bool))                     \
+        {                                 \
+            fprintf(stderr, __VA_ARGS__); \
+            cpu_exit(EXIT_FAILURE);       \
+        }                                 \
+    } while (0);
+
+
 #ifndef UNUSED
 #define UNUSED(x) (void)(x)
 #endif
@@ -27,11 +46,36 @@
 #define CHIP8_STACK_SIZE 16
 #define CHIP8_CYCLES_PER_FRAME 12
 
-#define CHIP8_MEMSIZE 0x0FFF
-#define XOCHIP_MEMSIZE 0xFFFF
+// Instruction dispatch engines, selected at build time with -DCHIP8_DISPATCH=...
+#define CHIP8_DISPATCH_SWITCH 0
+#define CHIP8_DISPATCH_THREADED 1
+#define CHIP8_DISPATCH_TABLE 2
+
+#ifndef CHIP8_DISPATCH
+#if defined(__GNUC__)
+#define CHIP8_DISPATCH CHIP8_DISPATCH_THREADED
+#else
+#define CHIP8_DISPATCH CHIP8_DISPATCH_SWITCH
+#endif
+#endif
+
+#define CHIP8_MEMSIZE 0x1000   // Address space of CHIP-8 and SUPER-CHIP programs.
+#define XOCHIP_MEMSIZE 0x10000 // Address space of XO-CHIP programs, all of it in game_memory.
+
+/* The platform's address space, see memory_size, is followed in game_memory
+   by a copy of its first CHIP8_MEMORY_GUARD bytes, kept up to date by
+   write_memory. An address wrapped to the platform's width plus an 8-bit
+   offset then reads the byte the wrapped address holds, without further
+   masking or checks. */
+#define CHIP8_MEMORY_GUARD 0x100
 
 #define CHIP8_SCREEN_WIDTH 128
 #define CHIP8_SCREEN_HEIGHT 64
+#define CHIP8_SCREEN_WORDS (CHIP8_SCREEN_WIDTH / 64) // uint64_t per row of a screen plane.
+#define CHIP8_LORES_WIDTH 64
+#define CHIP8_LORES_HEIGHT 32
+#define CHIP8_LORES_WORDS (CHIP8_LORES_WIDTH / 64)
+#define CHIP8_PLANES 4 // XO-CHIP bitplanes, one bit of each pixel's colour index per plane.
 
 #define SMALL_FONT_ADDRESS 0x0A0
 #define BIG_FONT_ADDRESS 0x000
@@ -47,40 +91,120 @@ typedef enum
     XOCHIP
 }Target_Platform;
 
+// Target given to -t by chip8 and chip8-aot: any prefix of Chip8, SuperChip or XO-Chip.
+static inline Target_Platform parse_target(const char *name)
+{
+    if (strncmp(name, "Chip8", strlen(name)) == 0)
+        return CHIP8;
+    if (strncmp(name, "SuperChip", strlen(name)) == 0)
+        return SCHIPC;
+    if (strncmp(name, "XO-Chip", strlen(name)) == 0)
+        return XOCHIP;
+    fprintf(stderr, "Unknown Chip8 variant '%s'.\nPossible options: Chip8 | SuperChip | XO-Chip \n", name);
+    exit(EXIT_FAILURE);
+}
+
 typedef enum
 {
     LORES,
     HIRES
 }Display_Mode;
 
+typedef enum
+{
+    ENGINE_INTERPRETER, // Fetch and decode every instruction.
+    ENGINE_PREDECODE,   // Reuse decoded instructions from the predecode cache.
+    ENGINE_BLOCK,       // Run whole cached basic blocks at once.
+    ENGINE_JIT,         // Compile hot blocks to native code, see Chip8_JIT.h.
+    ENGINE_AOT,         // Run blocks compiled ahead of time by chip8-aot, see Chip8_AOT.h.
+    ENGINE_COUNT
+}Chip8_Engine;
+
 typedef struct
 {
     WORD stack[CHIP8_STACK_SIZE];
     BYTE n_elements;
 } Stack;
 
-typedef struct
+typedef struct Chip8_CPU Chip8_CPU;
+typedef struct Chip8_Decoded Chip8_Decoded;
+typedef struct Chip8_JIT Chip8_JIT;
+typedef struct Chip8_AOT Chip8_AOT;
+typedef struct Chip8_Interpreter Chip8_Interpreter;
+typedef struct Chip8_Profile Chip8_Profile;
+
+typedef void (*Chip8_Handler)(Chip8_CPU *cpu, const Chip8_Decoded *op);
+
+// Predecode cache entry, one per even address of game_memory.
+struct Chip8_Decoded
 {
-    BYTE game_memory[0xFFFF];
-    BYTE game_registers[16];
+    Chip8_Handler handler; // NULL until the address is executed, or after it is written to.
+    WORD inst;
+    BYTE block_length;     // Instructions in the basic block starting here, 0 if not built yet.
+    BYTE length;           // Instructions run by `handler`, more than 1 for superinstructions.
+    BYTE skip;             // Bytes a taken skip moves past, see skip_distance; 0 if `handler` does not use it.
+    BYTE op;               // What the cached engines run: ENTRY_UNDECODED, ENTRY_HANDLER or ENTRY_OPCODE + opcode.
+};
+
+/* Values of Chip8_Decoded.op. The cached engines dispatch on it directly, so
+   an entry that is not decoded yet costs no separate check: its op leads to
+   the decoder. Superinstructions only run through `handler`. */
+enum
+{
+    ENTRY_UNDECODED,
+    ENTRY_HANDLER,
+    ENTRY_OPCODE
+};
+
+#define CHIP8_DECODE_CACHE_SIZE (XOCHIP_MEMSIZE / 2)
+#define CHIP8_MAX_BLOCK_LENGTH 32
+
+/* Hot state first, in two cache lines: the first holds what nearly every
+   instruction reads or writes, the second what the engines, draws and key
+   checks need. Memory and the screen planes follow, each starting on its
+   own cache line, so neither shares a line with the registers. This is a
+   layout choice, not a measured speedup: -n timings did not change and no
+   cache miss counts were taken. */
+#define CHIP8_CACHE_LINE 64
+
+struct Chip8_CPU
+{
+    _Alignas(CHIP8_CACHE_LINE) BYTE game_registers[16];
     WORD i_register;
     WORD program_counter;
     Stack call_stack;
-
-    BYTE screen_plane1[CHIP8_SCREEN_HEIGHT * CHIP8_SCREEN_WIDTH];
-    BYTE screen_plane2[CHIP8_SCREEN_HEIGHT * CHIP8_SCREEN_WIDTH];
-    BYTE dirty_flag;
+    BYTE delay_timer;
+    BYTE sound_timer;
+    BYTE idle;        // Busy waiting until the next timer tick, see OP_1NNN.
+    BYTE waiting_key; // Blocked on FX0A until cpu_key_event.
+    BYTE pressed_key;
+    BYTE bitplane;    // Planes selected by FN01, bit p for plane p.
     Display_Mode mode;
-    BYTE bitplane;
 
+    _Alignas(CHIP8_CACHE_LINE) Target_Platform target;
+    Chip8_Engine engine;
+    uint32_t random_state;
+    BYTE dirty_flag; // The screen changed since the frontend last cleared it.
+    BYTE screen_origins[CHIP8_PLANES];
     BYTE keys[16];
-    BYTE pressed_key;
+    const Chip8_Interpreter *interpreter; // Engines specialized for `target`, set by init_cpu.
+    Chip8_Decoded *decode_cache;
+    Chip8_JIT *jit;
 
-    BYTE delay_timer;
-    BYTE sound_timer;
+    Chip8_AOT *aot;           // Set by the caller before running with ENGINE_AOT.
+    Chip8_Profile *profile;   // Set to record a fusion profile, see Chip8_Profile.h.
+    uint64_t executed_cycles; // Instructions run by run_instructions.
+    uint64_t skipped_cycles;  // Cycles not run because the CPU was idle.
 
-    Target_Platform target;
-} Chip8_CPU;
+    _Alignas(CHIP8_CACHE_LINE) BYTE game_memory[XOCHIP_MEMSIZE + CHIP8_MEMORY_GUARD];
+
+    /* Bitsliced screen: plane p holds bit p of every pixel's colour, one bit
+       per pixel, leftmost pixel in the most significant bit. Hires rows take
+       CHIP8_SCREEN_WORDS words, lores rows CHIP8_LORES_WORDS. Each plane is a
+       ring of rows starting at its origin in screen_origins, read through
+       screen_row. */
+    _Alignas(CHIP8_CACHE_LINE) uint64_t screen_planes[CHIP8_PLANES][CHIP8_SCREEN_HEIGHT * CHIP8_SCREEN_WORDS];
+};
 
 static const BYTE small_font[] = {
     // Start at 0x0A0
@@ -125,11 +249,64 @@ static const BYTE big_font[] = {
     // End at 0x0A0
 };
 
+/* Chip8_Interpreter.c is built once per platform with CHIP8_SPECIALIZED_TARGET
+   set, which makes every platform check a compile-time constant. */
+#ifdef CHIP8_SPECIALIZED_TARGET
+#define CPU_TARGET(cpu) (CHIP8_SPECIALIZED_TARGET)
+#else
+#define CPU_TARGET(cpu) ((cpu)->target)
+#endif
+
+/* Bytes of address space: addresses wrap at 4K on CHIP-8 and SUPER-CHIP and
+   at 64K on XO-CHIP. The program counter is wrapped whenever code is read
+   or looked up in the decode cache, so a program running past the end
+   shares the cached code at the start of memory. */
+static inline uint32_t memory_size(const Chip8_CPU *cpu)
+{
+    UNUSED(cpu);
+    return (CPU_TARGET(cpu) == XOCHIP) ? XOCHIP_MEMSIZE : CHIP8_MEMSIZE;
+}
+
+// Big-endian word at `address`; the guard makes the last address wrap to 0 for its second byte.
+static inline WORD read_word(const Chip8_CPU *cpu, WORD address)
+{
+    address &= memory_size(cpu) - 1;
+    return (cpu->game_memory[address] << 8) | cpu->game_memory[address + 1];
+}
+
+/* Lores content is stored at its native 64x32 resolution, one word per row,
+   and only scaled up by the frontend. Both modes clear the screen when
+   entered, so the two layouts never mix. */
+static inline BYTE screen_words(const Chip8_CPU *cpu)
+{
+    return (cpu->mode == LORES) ? CHIP8_LORES_WORDS : CHIP8_SCREEN_WORDS;
+}
+
+static inline BYTE screen_height(const Chip8_CPU *cpu)
+{
+    return (cpu->mode == LORES) ? CHIP8_LORES_HEIGHT : CHIP8_SCREEN_HEIGHT;
+}
+
+// Row `y` of the screen in `plane`, whose first row is at `origin`.
+static inline uint64_t *screen_row(const Chip8_CPU *cpu, const uint64_t *plane, BYTE origin, BYTE y)
+{
+    return (uint64_t *)&plane[((origin + y) & (screen_height(cpu) - 1)) * screen_words(cpu)];
+}
 
 void init_cpu(Chip8_CPU *cpu, FILE *stream, Target_Platform target);
 
+void free_cpu(Chip8_CPU *cpu);
+
 void run_instructions(Chip8_CPU *cpu, uint32_t CPF);
 
+void cpu_key_event(Chip8_CPU *cpu, BYTE key, BYTE pressed);
+
 void update_timers(Chip8_CPU *cpu);
 
+const Chip8_Decoded *predecode(Chip8_CPU *cpu, WORD address);
+
+void invalidate_code(Chip8_CPU *cpu, WORD address);
+
+int cpu_state_equal(const Chip8_CPU *a, const Chip8_CPU *b);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,169 @@
+#ifndef CHIP8_DECODE_H
+#define CHIP8_DECODE_H 1
+
+#include "Chip8_CPU.h"
+
+// Every instruction form known to the emulator, in encoding order. OP_NULL stands for invalid encodings.
+#define CHIP8_OPCODES(X)                                                            \
+    X(00CN) X(00DN) X(00E0) X(00EE) X(00FB) X(00FC) X(00FD) X(00FE) X(00FF)         \
+    X(1NNN) X(2NNN) X(3XNN) X(4XNN) X(5XY0) X(5XY2) X(5XY3) X(6XNN) X(7XNN)         \
+    X(8XY0) X(8XY1) X(8XY2) X(8XY3) X(8XY4) X(8XY5) X(8XY6) X(8XY7) X(8XYE)         \
+    X(9XY0) X(ANNN) X(BNNN) X(CXNN) X(DXYN) X(EX9E) X(EXA1)                         \
+    X(F000) X(FN01) X(F002) X(FX07) X(FX0A) X(FX15) X(FX18) X(FX1E) X(FX29)         \
+    X(FX30) X(FX33) X(FX3A) X(FX55) X(FX65) X(FX75) X(FX85) X(NULL)
+
+// Conditional skips, each with a skips_* check in Chip8_Instructions.h.
+#define CHIP8_SKIP_OPCODES(X) X(3XNN) X(4XNN) X(5XY0) X(9XY0) X(EX9E) X(EXA1)
+
+typedef enum
+{
+#define X(op) OPCODE_##op,
+    CHIP8_OPCODES(X)
+#undef X
+    OPCODE_COUNT
+} Chip8_Opcode;
+
+// The opcode as spelled in CHIP8_OPCODES, which is also the suffix of its OP_* handler.
+static inline const char *opcode_name(Chip8_Opcode opcode)
+{
+    static const char *const opcode_names[OPCODE_COUNT] = {
+#define X(op) #op,
+        CHIP8_OPCODES(X)
+#undef X
+    };
+    return opcode_names[opcode];
+}
+
+// Same decode rules as exec_instruction and its aux_* helpers.
+static inline Chip8_Opcode decode_opcode(WORD inst)
+{
+    switch ((inst & 0xF000) >> 12)
+    {
+    case 0x0:
+        switch (((inst & 0x00E0) == 0x00C0) ? (inst & 0x00F0) : (inst & 0x00FF))
+        {
+        case 0xC0: return OPCODE_00CN;
+        case 0xD0: return OPCODE_00DN;
+        case 0xE0: return OPCODE_00E0;
+        case 0xEE: return OPCODE_00EE;
+        case 0xFB: return OPCODE_00FB;
+        case 0xFC: return OPCODE_00FC;
+        case 0xFD: return OPCODE_00FD;
+        case 0xFE: return OPCODE_00FE;
+        case 0xFF: return OPCODE_00FF;
+        default: return OPCODE_NULL;
+        }
+    case 0x1: return OPCODE_1NNN;
+    case 0x2: return OPCODE_2NNN;
+    case 0x3: return OPCODE_3XNN;
+    case 0x4: return OPCODE_4XNN;
+    case 0x5:
+        switch (inst & 0x000F)
+        {
+        case 0x0: return OPCODE_5XY0;
+        case 0x2: return OPCODE_5XY2;
+        case 0x3: return OPCODE_5XY3;
+        default: return OPCODE_NULL;
+        }
+    case 0x6: return OPCODE_6XNN;
+    case 0x7: return OPCODE_7XNN;
+    case 0x8:
+        switch (inst & 0x000F)
+        {
+        case 0x0: return OPCODE_8XY0;
+        case 0x1: return OPCODE_8XY1;
+        case 0x2: return OPCODE_8XY2;
+        case 0x3: return OPCODE_8XY3;
+        case 0x4: return OPCODE_8XY4;
+        case 0x5: return OPCODE_8XY5;
+        case 0x6: return OPCODE_8XY6;
+        case 0x7: return OPCODE_8XY7;
+        case 0xE: return OPCODE_8XYE;
+        default: return OPCODE_NULL;
+        }
+    case 0x9: return OPCODE_9XY0;
+    case 0xA: return OPCODE_ANNN;
+    case 0xB: return OPCODE_BNNN;
+    case 0xC: return OPCODE_CXNN;
+    case 0xD: return OPCODE_DXYN;
+    case 0xE:
+        switch (inst & 0x00FF)
+        {
+        case 0x9E: return OPCODE_EX9E;
+        case 0xA1: return OPCODE_EXA1;
+        default: return OPCODE_NULL;
+        }
+    default:
+        switch (inst & 0x00FF)
+        {
+        case 0x00: return OPCODE_F000;
+        case 0x01: return OPCODE_FN01;
+        case 0x02: return OPCODE_F002;
+        case 0x07: return OPCODE_FX07;
+        case 0x0A: return OPCODE_FX0A;
+        case 0x15: return OPCODE_FX15;
+        case 0x18: return OPCODE_FX18;
+        case 0x1E: return OPCODE_FX1E;
+        case 0x29: return OPCODE_FX29;
+        case 0x30: return OPCODE_FX30;
+        case 0x33: return OPCODE_FX33;
+        case 0x3A: return OPCODE_FX3A;
+        case 0x55: return OPCODE_FX55;
+        case 0x65: return OPCODE_FX65;
+        case 0x75: return OPCODE_FX75;
+        case 0x85: return OPCODE_FX85;
+        default: return OPCODE_NULL;
+        }
+    }
+}
+
+/* Instructions that end a basic block: anything that may leave the program
+   counter somewhere else than the next instruction (jumps, skips, calls,
+   returns, F000, FX0A...), DXYN, and every instruction that writes memory,
+   so a block never runs code it has just modified. */
+static inline int opcode_ends_block(Chip8_Opcode opcode)
+{
+    switch (opcode)
+    {
+    case OPCODE_00EE:
+    case OPCODE_00FD:
+    case OPCODE_1NNN:
+    case OPCODE_2NNN:
+    case OPCODE_3XNN:
+    case OPCODE_4XNN:
+    case OPCODE_5XY0:
+    case OPCODE_5XY2:
+    case OPCODE_9XY0:
+    case OPCODE_BNNN:
+    case OPCODE_DXYN:
+    case OPCODE_EX9E:
+    case OPCODE_EXA1:
+    case OPCODE_F000:
+    case OPCODE_F002:
+    case OPCODE_FX0A:
+    case OPCODE_FX33:
+    case OPCODE_FX3A:
+    case OPCODE_FX55:
+    case OPCODE_FX75:
+    case OPCODE_FX85:
+    case OPCODE_NULL:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* A jump at `address` back to "FX07; 3X00" right before it: the ROM waits
+   for the delay timer, which only changes between frames. */
+static inline int is_delay_wait(const BYTE *memory, WORD address, WORD target)
+{
+    if ((WORD)(target + 4) != address)
+        return 0;
+
+    WORD load = (memory[target] << 8) | memory[target + 1];
+    WORD skip = (memory[target + 2] << 8) | memory[target + 3];
+
+    return (load & 0xF0FF) == 0xF007 && (skip & 0xF0FF) == 0x3000 && (skip & 0x0F00) == (load & 0x0F00);
+}
+
+#endif
@@ -2,22 +2,34 @@
 #define CHIP8_INSTRUCTIONS_H 1
 
 #include "Chip8_CPU.h"
+#include "Chip8_Decode.h"
 
 // OP-CODE Guide from https://github.com/mattmikolay/chip-8/wiki/CHIP%E2%80%908-Instruction-Set
 
 static inline void return_subroutine(Chip8_CPU *cpu)
 {
-    ASSERT((cpu->call_stack.n_elements > 0), "[ERROR] Tried to pop empty stack at PC: 0x%04x\n", cpu->program_counter);
+    CPU_ASSERT((cpu->call_stack.n_elements > 0), "[ERROR] Tried to pop empty stack at PC: 0x%04x\n", cpu->program_counter);
     cpu->program_counter = cpu->call_stack.stack[--cpu->call_stack.n_elements];
 }
 
 static inline void jump_subroutine(Chip8_CPU *cpu, WORD address)
 {
-    ASSERT((cpu->call_stack.n_elements < CHIP8_STACK_SIZE - 1), "[ERROR] Tried to push full stack at PC: 0x%04x\n", cpu->program_counter);
+    CPU_ASSERT((cpu->call_stack.n_elements < CHIP8_STACK_SIZE - 1), "[ERROR] Tried to push full stack at PC: 0x%04x\n", cpu->program_counter);
     cpu->call_stack.stack[cpu->call_stack.n_elements++] = cpu->program_counter;
     cpu->program_counter = address;
 }
 
+// xorshift32, kept per CPU so that two instances running the same ROM stay in lockstep.
+static inline BYTE random_byte(Chip8_CPU *cpu)
+{
+    uint32_t x = cpu->random_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    cpu->random_state = x;
+    return x >> 24;
+}
+
 static inline void reset_stack(Stack *stack)
 {
     memset(stack->stack, 0, sizeof(stack->stack));
@@ -48,14 +60,27 @@ static inline BYTE get_vy(Chip8_CPU *cpu, WORD instruction)
     return cpu->game_registers[vY];
 }
 
+/* Every store to game_memory goes through here so stale predecoded
+   instructions and blocks are dropped. Stores to the first
+   CHIP8_MEMORY_GUARD bytes are repeated in the guard at the end. */
+static inline void write_memory(Chip8_CPU *cpu, WORD address, BYTE value)
+{
+    address &= memory_size(cpu) - 1;
+    cpu->game_memory[address] = value;
+    cpu->game_memory[(address < CHIP8_MEMORY_GUARD) ? memory_size(cpu) + address : address] = value;
+    // The cached skip before `address`, if any, depends on the instruction there too.
+    if (cpu->decode_cache[address >> 1].handler != NULL || cpu->decode_cache[((address - 2) & (memory_size(cpu) - 1)) >> 1].skip != 0)
+        invalidate_code(cpu, address);
+}
+
 static inline void dump_vxy(Chip8_CPU *cpu, BYTE min, BYTE max)
 {
     for (BYTE x = min; x <= max; x++)
     {
-        cpu->game_memory[cpu->i_register + x] = cpu->game_registers[x];
+        write_memory(cpu, cpu->i_register + x, cpu->game_registers[x]);
     }
 
-    if (cpu->target != SCHIPC)
+    if (CPU_TARGET(cpu) != SCHIPC)
         cpu->i_register += max + 1;
 }
 
@@ -63,10 +88,10 @@ static inline void load_vxy(Chip8_CPU *cpu, BYTE min, BYTE max)
 {
     for (BYTE x = min; x <= max; x++)
     {
-        cpu->game_registers[x] = cpu->game_memory[cpu->i_register + x];
+        cpu->game_registers[x] = cpu->game_memory[(cpu->i_register & (memory_size(cpu) - 1)) + x];
     }
 
-    if (cpu->target != SCHIPC)
+    if (CPU_TARGET(cpu) != SCHIPC)
         cpu->i_register += max + 1;
 }
 
@@ -88,167 +113,120 @@ static inline void wait_key(Chip8_CPU *cpu, WORD instruction)
             break;
         }
     }
+
+    // Nothing changes until a key does, cpu_key_event wakes the CPU to run FX0A again.
     cpu->program_counter -= 2;
+    cpu->waiting_key = 1;
+    cpu->idle = 1;
 }
 
-static inline void draw_sprite_lores_clipping(Chip8_CPU *cpu, WORD instruction)
+/* Collects the planes selected by FN01 for a sprite draw. Each selected
+   plane takes the next `size` bytes of sprite data from I on, as XO-CHIP
+   specifies. Returns how many planes are selected. */
+static inline BYTE select_planes(Chip8_CPU *cpu, uint64_t **planes, BYTE *origins, WORD *addresses, BYTE size)
 {
-    BYTE coordX = (get_vx(cpu, instruction) & 63) * 2;
-    BYTE coordY = (get_vy(cpu, instruction) & 31) * 2;
-    BYTE height = (instruction & 0xF);
-    BYTE row;
+    WORD address = cpu->i_register;
+    BYTE count = 0;
 
-    cpu->game_registers[0xF] = 0;
-
-    for (BYTE yline = 0; yline < height && (coordY + (yline * 2)) < CHIP8_SCREEN_HEIGHT; yline++)
+    for (BYTE plane = 0; plane < CHIP8_PLANES; plane++)
     {
-        row = cpu->game_memory[cpu->i_register + yline];
-        for (BYTE xpixel = 0; xpixel < 8 && (coordX + (xpixel * 2)) < CHIP8_SCREEN_WIDTH; xpixel++)
+        if (cpu->bitplane & (1 << plane))
         {
-            if (row & (0x80 >> xpixel))
-            {
-                WORD pos1 = coordX + (xpixel * 2) + ((coordY + (yline * 2)) * CHIP8_SCREEN_WIDTH);
-
-                if (cpu->screen_plane1[pos1] == 1)
-                {
-                    cpu->game_registers[0xF] = 1;
-                }
-
-                cpu->screen_plane1[pos1] ^= 1;
-                cpu->screen_plane1[pos1 + 1] ^= 1;
-                cpu->screen_plane1[pos1 + CHIP8_SCREEN_WIDTH] ^= 1;
-                cpu->screen_plane1[pos1 + CHIP8_SCREEN_WIDTH + 1] ^= 1;
-            }
+            planes[count] = cpu->screen_planes[plane];
+            origins[count] = cpu->screen_origins[plane];
+            addresses[count++] = address & (memory_size(cpu) - 1);
+            address += size;
         }
     }
-    cpu->dirty_flag = 1;
-}
-
-static inline void draw_sprite_lores_warping(Chip8_CPU *cpu, WORD instruction)
-{
-    BYTE coordX = (get_vx(cpu, instruction) & 63) * 2;
-    BYTE coordY = (get_vy(cpu, instruction) & 31) * 2;
-    BYTE height = (instruction & 0xF);
-    BYTE both_planes = 0;
-    WORD start_addr;
-    BYTE row;
-
-    cpu->game_registers[0xF] = 0;
-
-    if (cpu->bitplane & 0x1)
+    return count;
+}
+
+/* Draws an 8xN sprite on every selected plane in one pass over the rows.
+   All rows land on the same columns, so where they split between words and
+   whether the right part is clipped is worked out once; each row of each
+   plane is then two XORs. Collisions are ORed together and tested once. */
+static inline void draw_sprite(Chip8_CPU *cpu, BYTE coordX, BYTE coordY, BYTE height, BYTE wrap)
+{
+    BYTE words = screen_words(cpu);
+    BYTE rows = screen_height(cpu);
+    BYTE word = coordX >> 6;
+    BYTE shift = coordX & 63;
+    BYTE next = (word + 1 == words) ? 0 : word + 1;
+    uint64_t spill_mask = (shift == 0 || (next == 0 && !wrap)) ? 0 : ~(uint64_t)0;
+    BYTE lines = (wrap || coordY + height <= rows) ? height : rows - coordY;
+    uint64_t *planes[CHIP8_PLANES];
+    BYTE origins[CHIP8_PLANES];
+    WORD addresses[CHIP8_PLANES];
+    BYTE count = select_planes(cpu, planes, origins, addresses, height);
+    uint64_t collision = 0;
+
+    for (BYTE yline = 0; yline < lines; yline++)
     {
-        for (BYTE yline = 0; yline < height; yline++)
+        for (BYTE i = 0; i < count; i++)
         {
-            row = cpu->game_memory[cpu->i_register + yline];
-            for (BYTE xpixel = 0; xpixel < 8; xpixel++)
-            {
-                if (row & (0x80 >> xpixel))
-                {
-                    WORD pos1 = ((coordX + (xpixel * 2)) % CHIP8_SCREEN_WIDTH) + (((coordY + (yline * 2)) % CHIP8_SCREEN_HEIGHT) * CHIP8_SCREEN_WIDTH);
-
-                    if (cpu->screen_plane1[pos1] == 1)
-                    {
-                        cpu->game_registers[0xF] = 1;
-                    }
-
-                    cpu->screen_plane1[pos1] ^= 1;
-                    cpu->screen_plane1[pos1 + 1] ^= 1;
-                    cpu->screen_plane1[pos1 + CHIP8_SCREEN_WIDTH] ^= 1;
-                    cpu->screen_plane1[pos1 + CHIP8_SCREEN_WIDTH + 1] ^= 1;
-                }
-            }
+            uint64_t *row = screen_row(cpu, planes[i], origins[i], coordY + yline);
+            uint64_t sprite = (uint64_t)cpu->game_memory[addresses[i] + yline] << 56;
+            uint64_t first = sprite >> shift;
+            uint64_t spill = (sprite << ((64 - shift) & 63)) & spill_mask;
+
+            collision |= (row[word] & first) | (row[next] & spill);
+            row[word] ^= first;
+            row[next] ^= spill;
         }
-
-        both_planes = 1;
     }
 
-    start_addr = (both_planes) ? cpu->i_register + height : cpu->i_register;
-
-    if (cpu->bitplane & 0x2)
+    cpu->game_registers[0xF] = collision != 0;
+    if (count != 0 && lines != 0)
+        cpu->dirty_flag = 1;
+}
+
+/* DXY0 kernel: draws a 16x16 sprite, 32 bytes per selected plane, in hires.
+   Same setup as draw_sprite with the row count fixed at 16, and each row a
+   16-bit load from two sprite bytes. */
+static inline void draw_sprite_big(Chip8_CPU *cpu, BYTE coordX, BYTE coordY, BYTE wrap)
+{
+    BYTE words = screen_words(cpu);
+    BYTE rows = screen_height(cpu);
+    BYTE word = coordX >> 6;
+    BYTE shift = coordX & 63;
+    BYTE next = (word + 1 == words) ? 0 : word + 1;
+    uint64_t spill_mask = (shift == 0 || (next == 0 && !wrap)) ? 0 : ~(uint64_t)0;
+    BYTE lines = (wrap || coordY + 16 <= rows) ? 16 : rows - coordY;
+    uint64_t *planes[CHIP8_PLANES];
+    BYTE origins[CHIP8_PLANES];
+    WORD addresses[CHIP8_PLANES];
+    BYTE count = select_planes(cpu, planes, origins, addresses, 32);
+    uint64_t collision = 0;
+
+    for (BYTE yline = 0; yline < lines; yline++)
     {
-        for (BYTE yline = 0; yline < height; yline++)
+        for (BYTE i = 0; i < count; i++)
         {
-            row = cpu->game_memory[start_addr + yline];
-            for (BYTE xpixel = 0; xpixel < 8; xpixel++)
-            {
-                if (row & (0x80 >> xpixel))
-                {
-                    WORD pos1 = ((coordX + (xpixel * 2)) % CHIP8_SCREEN_WIDTH) + (((coordY + (yline * 2)) % CHIP8_SCREEN_HEIGHT) * CHIP8_SCREEN_WIDTH);
-
-                    if (cpu->screen_plane2[pos1] == 1)
-                    {
-                        cpu->game_registers[0xF] = 1;
-                    }
-
-                    cpu->screen_plane2[pos1] ^= 1;
-                    cpu->screen_plane2[pos1 + 1] ^= 1;
-                    cpu->screen_plane2[pos1 + CHIP8_SCREEN_WIDTH] ^= 1;
-                    cpu->screen_plane2[pos1 + CHIP8_SCREEN_WIDTH + 1] ^= 1;
-                }
-            }
+            uint64_t *row = screen_row(cpu, planes[i], origins[i], coordY + yline);
+            const BYTE *data = &cpu->game_memory[addresses[i] + yline * 2];
+            uint64_t sprite = (uint64_t)((data[0] << 8) | data[1]) << 48;
+            uint64_t first = sprite >> shift;
+            uint64_t spill = (sprite << ((64 - shift) & 63)) & spill_mask;
+
+            collision |= (row[word] & first) | (row[next] & spill);
+            row[word] ^= first;
+            row[next] ^= spill;
         }
     }
 
-    cpu->dirty_flag = 1;
+    cpu->game_registers[0xF] = collision != 0;
+    if (count != 0 && lines != 0)
+        cpu->dirty_flag = 1;
 }
 
-// TODO: Warping Version
-static inline void draw_sprite_big(Chip8_CPU *cpu, BYTE coordX, BYTE coordY)
+static inline void draw_sprite_lores_clipping(Chip8_CPU *cpu, WORD instruction)
 {
-    WORD row;
-    BYTE both_planes = 0;
-    WORD start_addr;
-    cpu->game_registers[0xF] = 0;
-
-    if (cpu->bitplane & 0x1)
-    {
-        for (BYTE yline = 0; yline < 16 && (coordY + yline) < CHIP8_SCREEN_HEIGHT; yline++)
-        {
-            row = (cpu->game_memory[cpu->i_register + yline * 2] << 8) | cpu->game_memory[cpu->i_register + yline * 2 + 1];
-            for (BYTE xpixel = 0; xpixel < 16 && (coordX + xpixel) < CHIP8_SCREEN_WIDTH; xpixel++)
-            {
-                if (row & (0x8000 >> xpixel))
-                {
-                    WORD pos1 = coordX + xpixel + ((coordY + yline) * CHIP8_SCREEN_WIDTH);
-
-                    if (cpu->screen_plane1[pos1] == 1)
-                    {
-                        cpu->game_registers[0xF] = 1;
-                    }
-
-                    cpu->screen_plane1[pos1] ^= 1;
-                }
-            }
-        }
-
-        both_planes = 1;
-    }
-
-    start_addr = (both_planes) ? cpu->i_register + 16 * 2 : cpu->i_register;
-
-    if (cpu->bitplane & 0x2)
-    {
-        for (BYTE yline = 0; yline < 16 && (coordY + yline) < CHIP8_SCREEN_HEIGHT; yline++)
-        {
-            row = (cpu->game_memory[start_addr + yline * 2] << 8) | cpu->game_memory[start_addr + yline * 2 + 1];
-            for (BYTE xpixel = 0; xpixel < 16 && (coordX + xpixel) < CHIP8_SCREEN_WIDTH; xpixel++)
-            {
-                if (row & (0x8000 >> xpixel))
-                {
-                    WORD pos1 = coordX + xpixel + ((coordY + yline) * CHIP8_SCREEN_WIDTH);
-
-                    if (cpu->screen_plane2[pos1] == 1)
-                    {
-                        cpu->game_registers[0xF] = 1;
-                    }
-
-                    cpu->screen_plane2[pos1] ^= 1;
-                }
-            }
-        }
-    }
+    draw_sprite(cpu, get_vx(cpu, instruction) & 63, get_vy(cpu, instruction) & 31, instruction & 0xF, 0);
+}
 
-    cpu->dirty_flag = 1;
+static inline void draw_sprite_lores_warping(Chip8_CPU *cpu, WORD instruction)
+{
+    draw_sprite(cpu, get_vx(cpu, instruction) & 63, get_vy(cpu, instruction) & 31, instruction & 0xF, 1);
 }
 
 static inline void draw_sprite_hires_clipping(Chip8_CPU *cpu, WORD instruction)
@@ -256,35 +234,11 @@ static inline void draw_sprite_hires_clipping(Chip8_CPU *cpu, WORD instruction)
     BYTE coordX = get_vx(cpu, instruction) & 127;
     BYTE coordY = get_vy(cpu, instruction) & 63;
     BYTE height = (instruction & 0xF);
-    BYTE row;
 
     if (height == 0)
-    {
-        draw_sprite_big(cpu, coordX, coordY);
-        return;
-    }
-
-    cpu->game_registers[0xF] = 0;
-
-    for (BYTE yline = 0; yline < height && (coordY + yline) < CHIP8_SCREEN_HEIGHT; yline++)
-    {
-        row = cpu->game_memory[cpu->i_register + yline];
-        for (BYTE xpixel = 0; xpixel < 8 && (coordX + xpixel) < CHIP8_SCREEN_WIDTH; xpixel++)
-        {
-            if ((row & (0x80 >> xpixel)) != 0)
-            {
-                WORD pos1 = coordX + xpixel + ((coordY + yline) * CHIP8_SCREEN_WIDTH);
-
-                if (cpu->screen_plane1[pos1] == 1)
-                {
-                    cpu->game_registers[0xF] = 1;
-                }
-
-                cpu->screen_plane1[pos1] ^= 1;
-            }
-        }
-    }
-    cpu->dirty_flag = 1;
+        draw_sprite_big(cpu, coordX, coordY, 0);
+    else
+        draw_sprite(cpu, coordX, coordY, height, 0);
 }
 
 static inline void draw_sprite_hires_warping(Chip8_CPU *cpu, WORD instruction)
@@ -292,66 +246,58 @@ static inline void draw_sprite_hires_warping(Chip8_CPU *cpu, WORD instruction)
     BYTE coordX = get_vx(cpu, instruction) & 127;
     BYTE coordY = get_vy(cpu, instruction) & 63;
     BYTE height = (instruction & 0xF);
-    BYTE both_planes = 0;
-    WORD start_addr;
-    BYTE row;
 
     if (height == 0)
-    {
-        draw_sprite_big(cpu, coordX, coordY);
-        return;
-    }
+        draw_sprite_big(cpu, coordX, coordY, 1);
+    else
+        draw_sprite(cpu, coordX, coordY, height, 1);
+}
 
-    cpu->game_registers[0xF] = 0;
+// Clears `count` rows of `plane` from row `y` on.
+static inline void clear_rows(Chip8_CPU *cpu, uint64_t *plane, BYTE origin, BYTE y, BYTE count)
+{
+    for (BYTE row = 0; row < count; row++)
+        memset(screen_row(cpu, plane, origin, y + row), 0, screen_words(cpu) * sizeof(uint64_t));
+}
 
-    if (cpu->bitplane & 0x1)
-    {
-        for (BYTE yline = 0; yline < height; yline++)
-        {
-            row = cpu->game_memory[cpu->i_register + yline];
-            for (BYTE xpixel = 0; xpixel < 8; xpixel++)
-            {
-                if ((row & (0x80 >> xpixel)) != 0)
-                {
-                    WORD pos1 = ((coordX + xpixel) % CHIP8_SCREEN_WIDTH) + (((coordY + yline) % CHIP8_SCREEN_HEIGHT) * CHIP8_SCREEN_WIDTH);
-
-                    if (cpu->screen_plane1[pos1] == 1)
-                    {
-                        cpu->game_registers[0xF] = 1;
-                    }
-
-                    cpu->screen_plane1[pos1] ^= 1;
-                }
-            }
-        }
-        both_planes = 1;
-    }
+/* Scrolls `plane` `amount` rows down by moving its origin back, so only the
+   rows that come in at the top are written. */
+static inline void scroll_plane_down(Chip8_CPU *cpu, uint64_t *plane, BYTE *origin, BYTE amount)
+{
+    *origin = (*origin - amount) & (screen_height(cpu) - 1);
+    clear_rows(cpu, plane, *origin, 0, amount);
+}
 
-    start_addr = (both_planes) ? cpu->i_register + height : cpu->i_register;
+static inline void scroll_plane_up(Chip8_CPU *cpu, uint64_t *plane, BYTE *origin, BYTE amount)
+{
+    *origin = (*origin + amount) & (screen_height(cpu) - 1);
+    clear_rows(cpu, plane, *origin, screen_height(cpu) - amount, amount);
+}
 
-    if(cpu->bitplane & 0x2)
+// Scrolls every row of a packed plane `amount` pixels right, shifting in blank pixels.
+static inline void scroll_plane_right(uint64_t *plane, BYTE words, BYTE rows, BYTE amount)
+{
+    for (BYTE y = 0; y < rows; y++)
     {
-        for (BYTE yline = 0; yline < height; yline++)
-        {
-            row = cpu->game_memory[start_addr + yline];
-            for (BYTE xpixel = 0; xpixel < 8; xpixel++)
-            {
-                if ((row & (0x80 >> xpixel)) != 0)
-                {
-                    WORD pos1 = ((coordX + xpixel) % CHIP8_SCREEN_WIDTH) + (((coordY + yline) % CHIP8_SCREEN_HEIGHT) * CHIP8_SCREEN_WIDTH);
-
-                    if (cpu->screen_plane2[pos1] == 1)
-                    {
-                        cpu->game_registers[0xF] = 1;
-                    }
-
-                    cpu->screen_plane2[pos1] ^= 1;
-                }
-            }
-        }
+        uint64_t *row = &plane[y * words];
+
+        for (BYTE word = words - 1; word > 0; word--)
+            row[word] = (row[word] >> amount) | (row[word - 1] << (64 - amount));
+        row[0] >>= amount;
     }
+}
 
-    cpu->dirty_flag = 1;
+// Scrolls every row of a packed plane `amount` pixels left, shifting in blank pixels.
+static inline void scroll_plane_left(uint64_t *plane, BYTE words, BYTE rows, BYTE amount)
+{
+    for (BYTE y = 0; y < rows; y++)
+    {
+        uint64_t *row = &plane[y * words];
+
+        for (BYTE word = 0; word < words - 1; word++)
+            row[word] = (row[word] << amount) | (row[word + 1] >> (64 - amount));
+        row[words - 1] <<= amount;
+    }
 }
 
 /* 00CN: Scroll screen content down N pixel.
@@ -363,21 +309,13 @@ static inline void OP_00CN(Chip8_CPU *cpu, WORD inst)
 {
     BYTE amount = inst & 0x00F;
 
-    if (cpu->mode == LORES)
-        amount *= 2;
-
-    if (cpu->target == CHIP8)
-        ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
+    if (CPU_TARGET(cpu) == CHIP8)
+        CPU_ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
 
-    if (cpu->bitplane & 1)
+    for (BYTE plane = 0; plane < CHIP8_PLANES; plane++)
     {
-        memmove(cpu->screen_plane1 + (amount * CHIP8_SCREEN_WIDTH), cpu->screen_plane1, (CHIP8_SCREEN_HEIGHT - amount) * CHIP8_SCREEN_WIDTH);
-        memset(cpu->screen_plane1, 0, amount * CHIP8_SCREEN_WIDTH);
-    }
-    if (cpu->bitplane & 2)
-    {
-        memmove(cpu->screen_plane2 + (amount * CHIP8_SCREEN_WIDTH), cpu->screen_plane2, (CHIP8_SCREEN_HEIGHT - amount) * CHIP8_SCREEN_WIDTH);
-        memset(cpu->screen_plane2, 0, amount * CHIP8_SCREEN_WIDTH);
+        if (cpu->bitplane & (1 << plane))
+            scroll_plane_down(cpu, cpu->screen_planes[plane], &cpu->screen_origins[plane], amount);
     }
 
     cpu->dirty_flag = 1;
@@ -392,21 +330,13 @@ static inline void OP_00DN(Chip8_CPU *cpu, WORD inst)
 {
     BYTE amount = inst & 0x00F;
 
-    if (cpu->target != XOCHIP)
-        ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (cpu->target == 0) ? "Chip-8" : "SUPER CHIP");
-
-    if (cpu->mode == LORES)
-        amount *= 2;
+    if (CPU_TARGET(cpu) != XOCHIP)
+        CPU_ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (CPU_TARGET(cpu) == 0) ? "Chip-8" : "SUPER CHIP");
 
-    if (cpu->bitplane & 1)
-    {
-        memmove(cpu->screen_plane1, cpu->screen_plane1 + (amount * CHIP8_SCREEN_WIDTH), (CHIP8_SCREEN_HEIGHT - amount) * CHIP8_SCREEN_WIDTH);
-        memset(cpu->screen_plane1 + (amount * CHIP8_SCREEN_WIDTH), 0, amount * CHIP8_SCREEN_WIDTH);
-    }
-    if (cpu->bitplane & 2)
+    for (BYTE plane = 0; plane < CHIP8_PLANES; plane++)
     {
-        memmove(cpu->screen_plane2, cpu->screen_plane2 + (amount * CHIP8_SCREEN_WIDTH), (CHIP8_SCREEN_HEIGHT - amount) * CHIP8_SCREEN_WIDTH);
-        memset(cpu->screen_plane2 + (amount * CHIP8_SCREEN_WIDTH), 0, amount * CHIP8_SCREEN_WIDTH);
+        if (cpu->bitplane & (1 << plane))
+            scroll_plane_up(cpu, cpu->screen_planes[plane], &cpu->screen_origins[plane], amount);
     }
 
     cpu->dirty_flag = 1;
@@ -417,17 +347,21 @@ static inline void OP_00DN(Chip8_CPU *cpu, WORD inst)
     - SCHIPC: Normal behaviour.
     - XO-CHIP: Only selected bit planes are cleared.
 */
-static inline void OP_00E0(Chip8_CPU *cpu)
+static inline void OP_00E0(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->bitplane & 1)
-        memset(cpu->screen_plane1, 0, sizeof(cpu->screen_plane1));
-    if (cpu->bitplane & 2)
-        memset(cpu->screen_plane2, 0, sizeof(cpu->screen_plane2));
+    UNUSED(inst);
+    for (BYTE plane = 0; plane < CHIP8_PLANES; plane++)
+    {
+        if (cpu->bitplane & (1 << plane))
+            memset(cpu->screen_planes[plane], 0, sizeof(cpu->screen_planes[plane]));
+    }
+    cpu->dirty_flag = 1;
 }
 
 // 00EE: Return from a subroutine.
-static inline void OP_00EE(Chip8_CPU *cpu)
+static inline void OP_00EE(Chip8_CPU *cpu, WORD inst)
 {
+    UNUSED(inst);
     return_subroutine(cpu);
 }
 
@@ -440,29 +374,13 @@ static inline void OP_00FB(Chip8_CPU *cpu, WORD inst)
 {
     BYTE amount = 4;
 
-    if (cpu->target == CHIP8)
-        ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
+    if (CPU_TARGET(cpu) == CHIP8)
+        CPU_ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
 
-    if (cpu->mode == LORES)
-        amount = 8;
-
-    if (cpu->bitplane & 1)
+    for (BYTE plane = 0; plane < CHIP8_PLANES; plane++)
     {
-        for (BYTE y = 0; y < CHIP8_SCREEN_HEIGHT; y++)
-        {
-            BYTE *row = cpu->screen_plane1 + (CHIP8_SCREEN_WIDTH * y);
-            memmove(row + amount, row, CHIP8_SCREEN_WIDTH - amount);
-            memset(row, 0, amount);
-        }
-    }
-    if (cpu->bitplane & 2)
-    {
-        for (BYTE y = 0; y < CHIP8_SCREEN_HEIGHT; y++)
-        {
-            BYTE *row = cpu->screen_plane2 + (CHIP8_SCREEN_WIDTH * y);
-            memmove(row + amount, row, CHIP8_SCREEN_WIDTH - amount);
-            memset(row, 0, amount);
-        }
+        if (cpu->bitplane & (1 << plane))
+            scroll_plane_right(cpu->screen_planes[plane], screen_words(cpu), screen_height(cpu), amount);
     }
     cpu->dirty_flag = 1;
 }
@@ -476,29 +394,13 @@ static inline void OP_00FC(Chip8_CPU *cpu, WORD inst)
 {
     BYTE amount = 4;
 
-    if (cpu->target == CHIP8)
-        ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
-
-    if (cpu->mode == LORES)
-        amount = 8;
+    if (CPU_TARGET(cpu) == CHIP8)
+        CPU_ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
 
-    if (cpu->bitplane & 1)
-    {
-        for (BYTE y = 0; y < CHIP8_SCREEN_HEIGHT; y++)
-        {
-            BYTE *row = cpu->screen_plane1 + (CHIP8_SCREEN_WIDTH * y);
-            memmove(row, row + amount, CHIP8_SCREEN_WIDTH - amount);
-            memset(row + amount, 0, amount);
-        }
-    }
-    if (cpu->bitplane & 2)
+    for (BYTE plane = 0; plane < CHIP8_PLANES; plane++)
     {
-        for (BYTE y = 0; y < CHIP8_SCREEN_HEIGHT; y++)
-        {
-            BYTE *row = cpu->screen_plane2 + (CHIP8_SCREEN_WIDTH * y);
-            memmove(row, row + amount, CHIP8_SCREEN_WIDTH - amount);
-            memset(row + amount, 0, amount);
-        }
+        if (cpu->bitplane & (1 << plane))
+            scroll_plane_left(cpu->screen_planes[plane], screen_words(cpu), screen_height(cpu), amount);
     }
     cpu->dirty_flag = 1;
 }
@@ -512,7 +414,7 @@ static inline void OP_00FD(Chip8_CPU *cpu, WORD inst)
 {
     UNUSED(cpu);
     UNUSED(inst);
-    exit(EXIT_SUCCESS); // TODO: otra manera de hacer esto?
+    cpu_exit(EXIT_SUCCESS);
 }
 
 /* O0FE: Switch to lores mode (64x32).
@@ -522,12 +424,13 @@ static inline void OP_00FD(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_00FE(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->target == CHIP8)
-        ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
+    if (CPU_TARGET(cpu) == CHIP8)
+        CPU_ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
 
     cpu->mode = LORES;
-    memset(cpu->screen_plane1, 0, sizeof(cpu->screen_plane1));
-    memset(cpu->screen_plane2, 0, sizeof(cpu->screen_plane2));
+    memset(cpu->screen_planes, 0, sizeof(cpu->screen_planes));
+    memset(cpu->screen_origins, 0, sizeof(cpu->screen_origins));
+    cpu->dirty_flag = 1;
 }
 
 /* O0FF: Switch to hires mode (128x64).
@@ -537,19 +440,25 @@ static inline void OP_00FE(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_00FF(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->target == CHIP8)
-        ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
+    if (CPU_TARGET(cpu) == CHIP8)
+        CPU_ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
 
     cpu->mode = HIRES;
 
-    memset(cpu->screen_plane1, 0, sizeof(cpu->screen_plane1));
-    memset(cpu->screen_plane2, 0, sizeof(cpu->screen_plane2));
+    memset(cpu->screen_planes, 0, sizeof(cpu->screen_planes));
+    memset(cpu->screen_origins, 0, sizeof(cpu->screen_origins));
+    cpu->dirty_flag = 1;
 }
 
 // 1NNN: Jump to address `NNN`.
 static inline void OP_1NNN(Chip8_CPU *cpu, WORD inst)
 {
+    WORD address = cpu->program_counter - 2;
     cpu->program_counter = (inst & 0x0fff);
+
+    // Nothing can change before the next timer tick, the engines skip the rest of the frame.
+    if (cpu->program_counter == address || (cpu->delay_timer != 0 && is_delay_wait(cpu->game_memory, address, cpu->program_counter)))
+        cpu->idle = 1;
 }
 
 // 2NNN: Execute subroutine starting at address `NNN`.
@@ -558,31 +467,29 @@ static inline void OP_2NNN(Chip8_CPU *cpu, WORD inst)
     jump_subroutine(cpu, (inst & 0x0fff));
 }
 
+/* Bytes a taken skip moves the program counter past the instruction at
+   `next`: XO-CHIP skips the whole 4 byte F000. The decoding engines work
+   this out once per address and cache it in Chip8_Decoded.skip; the
+   skips_* checks below tell whether the skip is taken. */
+static inline BYTE skip_distance(const Chip8_CPU *cpu, WORD next)
+{
+    return (CPU_TARGET(cpu) == XOCHIP && read_word(cpu, next) == 0xF000) ? 4 : 2;
+}
+
 /* 3XNN: Skip the following instruction if the value of register ``VX equals `NN`.
     - CHIP 8: Normal behaviour.
     - SCHIPC: Normal behaviour.
     - XO-CHIP: Skips 4 bytes if next instruction is F000.
 */
-static inline void OP_3XNN(Chip8_CPU *cpu, WORD inst)
+static inline int skips_3XNN(Chip8_CPU *cpu, WORD inst)
 {
+    return get_vx(cpu, inst) == (inst & 0xFF);
+}
 
-    BYTE value = get_vx(cpu, inst);
-    BYTE NN = inst & 0xFF;
-    if (value == NN)
-    {
-        cpu->program_counter += 2;
-
-        if (cpu->target == XOCHIP)
-        {
-            WORD next_inst = (cpu->game_memory[cpu->program_counter - 2] << 8) |
-                             cpu->game_memory[cpu->program_counter - 1];
-
-            if (next_inst == 0xF000)
-            {
-                cpu->program_counter += 2;
-            }
-        }
-    }
+static inline void OP_3XNN(Chip8_CPU *cpu, WORD inst)
+{
+    if (skips_3XNN(cpu, inst))
+        cpu->program_counter += skip_distance(cpu, cpu->program_counter);
 }
 
 /* 4XNN: Skip the following instruction if the value of register `VX` is not equal to `NN`.
@@ -590,26 +497,15 @@ static inline void OP_3XNN(Chip8_CPU *cpu, WORD inst)
     - SCHIPC: Normal behaviour.
     - XO-CHIP: Skips 4 bytes if next instruction is F000.
 */
-static inline void OP_4XNN(Chip8_CPU *cpu, WORD inst)
+static inline int skips_4XNN(Chip8_CPU *cpu, WORD inst)
 {
-    BYTE value = get_vx(cpu, inst);
-    BYTE NN = inst & 0xFF;
-
-    if (value != NN)
-    {
-        cpu->program_counter += 2;
-
-        if (cpu->target == XOCHIP)
-        {
-            WORD next_inst = (cpu->game_memory[cpu->program_counter - 2] << 8) |
-                             cpu->game_memory[cpu->program_counter - 1];
+    return get_vx(cpu, inst) != (inst & 0xFF);
+}
 
-            if (next_inst == 0xF000)
-            {
-                cpu->program_counter += 2;
-            }
-        }
-    }
+static inline void OP_4XNN(Chip8_CPU *cpu, WORD inst)
+{
+    if (skips_4XNN(cpu, inst))
+        cpu->program_counter += skip_distance(cpu, cpu->program_counter);
 }
 
 /* 5XY0: Skip the following instruction if the value of register `VX` is equal to the value of register `VY`.
@@ -617,26 +513,15 @@ static inline void OP_4XNN(Chip8_CPU *cpu, WORD inst)
     - SCHIPC: Normal behaviour.
     - XO-CHIP: Skips 4 bytes if next instruction is F000.
 */
-static inline void OP_5XY0(Chip8_CPU *cpu, WORD inst)
+static inline int skips_5XY0(Chip8_CPU *cpu, WORD inst)
 {
-    BYTE vx = get_vx(cpu, inst);
-    BYTE vy = get_vy(cpu, inst);
-
-    if (vx == vy)
-    {
-        cpu->program_counter += 2;
-
-        if (cpu->target == XOCHIP)
-        {
-            WORD next_inst = (cpu->game_memory[cpu->program_counter - 2] << 8) |
-                             cpu->game_memory[cpu->program_counter - 1];
+    return get_vx(cpu, inst) == get_vy(cpu, inst);
+}
 
-            if (next_inst == 0xF000)
-            {
-                cpu->program_counter += 2;
-            }
-        }
-    }
+static inline void OP_5XY0(Chip8_CPU *cpu, WORD inst)
+{
+    if (skips_5XY0(cpu, inst))
+        cpu->program_counter += skip_distance(cpu, cpu->program_counter);
 }
 
 /* 5XY2: Write registers vX to vY to memory pointed to by I. I stays the same.
@@ -646,8 +531,8 @@ static inline void OP_5XY0(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_5XY2(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->target != XOCHIP)
-        ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (cpu->target == 0) ? "Chip-8" : "SUPER CHIP");
+    if (CPU_TARGET(cpu) != XOCHIP)
+        CPU_ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (CPU_TARGET(cpu) == 0) ? "Chip-8" : "SUPER CHIP");
 
     BYTE min = get_vx(cpu, inst);
     BYTE max = get_vy(cpu, inst);
@@ -662,8 +547,8 @@ static inline void OP_5XY2(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_5XY3(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->target != XOCHIP)
-        ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (cpu->target == 0) ? "Chip-8" : "SUPER CHIP");
+    if (CPU_TARGET(cpu) != XOCHIP)
+        CPU_ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (CPU_TARGET(cpu) == 0) ? "Chip-8" : "SUPER CHIP");
 
     BYTE min = get_vx(cpu, inst);
     BYTE max = get_vy(cpu, inst);
@@ -702,7 +587,7 @@ static inline void OP_8XY1(Chip8_CPU *cpu, WORD inst)
     BYTE vx = get_vx(cpu, inst);
     BYTE vy = get_vy(cpu, inst);
     set_vx_value(cpu, inst, (vx | vy));
-    if (cpu->target == CHIP8)
+    if (CPU_TARGET(cpu) == CHIP8)
         cpu->game_registers[0xF] = 0;
 }
 
@@ -716,7 +601,7 @@ static inline void OP_8XY2(Chip8_CPU *cpu, WORD inst)
     BYTE vx = get_vx(cpu, inst);
     BYTE vy = get_vy(cpu, inst);
     set_vx_value(cpu, inst, (vx & vy));
-    if (cpu->target == CHIP8)
+    if (CPU_TARGET(cpu) == CHIP8)
         cpu->game_registers[0xF] = 0;
 }
 
@@ -730,7 +615,7 @@ static inline void OP_8XY3(Chip8_CPU *cpu, WORD inst)
     BYTE vx = get_vx(cpu, inst);
     BYTE vy = get_vy(cpu, inst);
     set_vx_value(cpu, inst, (vx ^ vy));
-    if (cpu->target == CHIP8)
+    if (CPU_TARGET(cpu) == CHIP8)
         cpu->game_registers[0xF] = 0;
 }
 
@@ -764,7 +649,7 @@ static inline void OP_8XY5(Chip8_CPU *cpu, WORD inst)
 static inline void OP_8XY6(Chip8_CPU *cpu, WORD inst)
 {
     BYTE reg;
-    if (cpu->target == SCHIPC)
+    if (CPU_TARGET(cpu) == SCHIPC)
         reg = get_vx(cpu, inst);
     else
         reg = get_vy(cpu, inst);
@@ -792,7 +677,7 @@ static inline void OP_8XY7(Chip8_CPU *cpu, WORD inst)
 static inline void OP_8XYE(Chip8_CPU *cpu, WORD inst)
 {
     BYTE reg;
-    if (cpu->target == SCHIPC)
+    if (CPU_TARGET(cpu) == SCHIPC)
         reg = get_vx(cpu, inst);
     else
         reg = get_vy(cpu, inst);
@@ -801,13 +686,20 @@ static inline void OP_8XYE(Chip8_CPU *cpu, WORD inst)
     cpu->game_registers[0xF] = (reg & 0x80) >> 7;
 }
 
-// 9XY0: Skip the following instruction if the value of register VX is not equal to the value of register VY.
+/* 9XY0: Skip the following instruction if the value of register `VX` is not equal to the value of register `VY`.
+    - CHIP 8: Normal behaviour.
+    - SCHIPC: Normal behaviour.
+    - XO-CHIP: Skips 4 bytes if next instruction is F000.
+*/
+static inline int skips_9XY0(Chip8_CPU *cpu, WORD inst)
+{
+    return get_vx(cpu, inst) != get_vy(cpu, inst);
+}
+
 static inline void OP_9XY0(Chip8_CPU *cpu, WORD inst)
 {
-    BYTE vx = get_vx(cpu, inst);
-    BYTE vy = get_vy(cpu, inst);
-    if (vx != vy)
-        cpu->program_counter += 2;
+    if (skips_9XY0(cpu, inst))
+        cpu->program_counter += skip_distance(cpu, cpu->program_counter);
 }
 
 // ANNN: Store memory address NNN in register I.
@@ -823,7 +715,7 @@ static inline void OP_ANNN(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_BNNN(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->target == SCHIPC)
+    if (CPU_TARGET(cpu) == SCHIPC)
         cpu->program_counter = get_vx(cpu, inst) + (inst & 0x0FFF);
     else
         cpu->program_counter = cpu->game_registers[0x0] + (inst & 0x0FFF);
@@ -832,7 +724,7 @@ static inline void OP_BNNN(Chip8_CPU *cpu, WORD inst)
 // CXNN: Set VX to a random number with a mask of NN.
 static inline void OP_CXNN(Chip8_CPU *cpu, WORD inst)
 {
-    set_vx_value(cpu, inst, (rand() & (inst & 0xFF)));
+    set_vx_value(cpu, inst, (random_byte(cpu) & (inst & 0xFF)));
 }
 
 /*DXYN: Draw a 8xN sprite at position VX, VY with N bytes of sprite data starting at the address stored in I. Set VF to 01 if any set pixels are changed to unset, and 00 otherwise.
@@ -844,7 +736,7 @@ static inline void OP_DXYN(Chip8_CPU *cpu, WORD inst)
 {
 
     // TODO:Cambiar esto a puntero a funcion almacenado en Chip8_CPU.
-    switch (cpu->target)
+    switch (CPU_TARGET(cpu))
     {
     case CHIP8:
         draw_sprite_lores_clipping(cpu, inst);
@@ -863,25 +755,15 @@ static inline void OP_DXYN(Chip8_CPU *cpu, WORD inst)
     - SCHIPC: Normal behaviour.
     - XO-CHIP: Skips 4 bytes if next instruction is F000.
 */
-static inline void OP_EX9E(Chip8_CPU *cpu, WORD inst)
+static inline int skips_EX9E(Chip8_CPU *cpu, WORD inst)
 {
-    BYTE vx = get_vx(cpu, inst);
-
-    if (cpu->keys[vx])
-    {
-        cpu->program_counter += 2;
-
-        if (cpu->target == XOCHIP)
-        {
-            WORD next_inst = (cpu->game_memory[cpu->program_counter - 2] << 8) |
-                             cpu->game_memory[cpu->program_counter - 1];
+    return cpu->keys[get_vx(cpu, inst)] != 0;
+}
 
-            if (next_inst == 0xF000)
-            {
-                cpu->program_counter += 2;
-            }
-        }
-    }
+static inline void OP_EX9E(Chip8_CPU *cpu, WORD inst)
+{
+    if (skips_EX9E(cpu, inst))
+        cpu->program_counter += skip_distance(cpu, cpu->program_counter);
 }
 
 /* EX9E: Skip the following instruction if the key corresponding to the hex value currently stored in register VX is not pressed.
@@ -889,25 +771,15 @@ static inline void OP_EX9E(Chip8_CPU *cpu, WORD inst)
     - SCHIPC: Normal behaviour.
     - XO-CHIP: Skips 4 bytes if next instruction is F000.
 */
-static inline void OP_EXA1(Chip8_CPU *cpu, WORD inst)
+static inline int skips_EXA1(Chip8_CPU *cpu, WORD inst)
 {
-    BYTE vx = get_vx(cpu, inst);
-
-    if (!cpu->keys[vx])
-    {
-        cpu->program_counter += 2;
-
-        if (cpu->target == XOCHIP)
-        {
-            WORD next_inst = (cpu->game_memory[cpu->program_counter - 2] << 8) |
-                             cpu->game_memory[cpu->program_counter - 1];
+    return cpu->keys[get_vx(cpu, inst)] == 0;
+}
 
-            if (next_inst == 0xF000)
-            {
-                cpu->program_counter += 2;
-            }
-        }
-    }
+static inline void OP_EXA1(Chip8_CPU *cpu, WORD inst)
+{
+    if (skips_EXA1(cpu, inst))
+        cpu->program_counter += skip_distance(cpu, cpu->program_counter);
 }
 
 /* F000: Assign next 16 bit word to I, and set PC behind it, this is a four byte instruction.
@@ -917,10 +789,10 @@ static inline void OP_EXA1(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_F000(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->target != XOCHIP)
-        ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (cpu->target == 0) ? "Chip-8" : "SUPER CHIP");
+    if (CPU_TARGET(cpu) != XOCHIP)
+        CPU_ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (CPU_TARGET(cpu) == 0) ? "Chip-8" : "SUPER CHIP");
 
-    cpu->i_register = (cpu->game_memory[cpu->program_counter] << 8) | cpu->game_memory[cpu->program_counter + 1];
+    cpu->i_register = read_word(cpu, cpu->program_counter);
 
     cpu->program_counter += 2;
 }
@@ -932,17 +804,11 @@ static inline void OP_F000(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_FN01(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->target != XOCHIP)
-        ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (cpu->target == 0) ? "Chip-8" : "SUPER CHIP");
-
-    BYTE plane = (inst & 0x0F00) >> 8;
-
-    if (plane < 1 || plane > 3)
-    {
-        ASSERT((0), "[ERROR] Invalid bitplane: %d. \"0x%04x\" at PC: 0x%04x\n", plane, inst, cpu->program_counter);
-    }
+    if (CPU_TARGET(cpu) != XOCHIP)
+        CPU_ASSERT((0), "[ERROR] XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: %s\n", inst, cpu->program_counter, (CPU_TARGET(cpu) == 0) ? "Chip-8" : "SUPER CHIP");
 
-    cpu->bitplane = plane;
+    // Any mask of the 4 planes is valid, 0 selects none and turns drawing into a no-op.
+    cpu->bitplane = (inst & 0x0F00) >> 8;
 }
 
 /* F002: Load 16 bytes audio pattern pointed to by I into audio pattern buffer.
@@ -952,7 +818,7 @@ static inline void OP_FN01(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_F002(Chip8_CPU *cpu, WORD inst)
 {
-    ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter); // TODO
+    CPU_ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter); // TODO
 }
 
 // FX07: Store the current value of the delay timer in register VX.
@@ -1000,8 +866,8 @@ static inline void OP_FX29(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_FX30(Chip8_CPU *cpu, WORD inst)
 {
-    if (cpu->target == CHIP8)
-        ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
+    if (CPU_TARGET(cpu) == CHIP8)
+        CPU_ASSERT((0), "[ERROR] SUPER CHIP/XO-CHIP instruction \"0x%04x\" at PC: 0x%04x. Current target: CHIP-8\n", inst, cpu->program_counter);
 
     BYTE vx = get_vx(cpu, inst);
 
@@ -1012,9 +878,9 @@ static inline void OP_FX30(Chip8_CPU *cpu, WORD inst)
 static inline void OP_FX33(Chip8_CPU *cpu, WORD inst)
 {
     BYTE vx = get_vx(cpu, inst);
-    cpu->game_memory[cpu->i_register] = vx / 100;
-    cpu->game_memory[cpu->i_register + 1] = (vx / 10) % 10;
-    cpu->game_memory[cpu->i_register + 2] = vx % 10;
+    write_memory(cpu, cpu->i_register, vx / 100);
+    write_memory(cpu, cpu->i_register + 1, (vx / 10) % 10);
+    write_memory(cpu, cpu->i_register + 2, vx % 10);
 }
 
 /* FX3A: Set audio pitch for a audio pattern playback rate of 4000*2^((vX-64)/48)Hz.
@@ -1024,7 +890,7 @@ static inline void OP_FX33(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_FX3A(Chip8_CPU *cpu, WORD inst)
 {
-    ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter);
+    CPU_ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter);
 }
 
 /* FX55: Store the values of registers V0 to VX inclusive in memory starting at address I
@@ -1056,7 +922,7 @@ static inline void OP_FX65(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_FX75(Chip8_CPU *cpu, WORD inst)
 {
-    ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter);
+    CPU_ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter);
 }
 
 /* FX85: Store the content of the registers v0 to vX into flags storage (outside of the addressable ram).
@@ -1066,12 +932,12 @@ static inline void OP_FX75(Chip8_CPU *cpu, WORD inst)
 */
 static inline void OP_FX85(Chip8_CPU *cpu, WORD inst)
 {
-    ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter);
+    CPU_ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter);
 }
 
 static inline void OP_NULL(Chip8_CPU *cpu, WORD inst)
 {
-    ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter);
+    CPU_ASSERT((0), "[ERROR] Unimplemented instruction \"0x%04x\" at PC: 0x%04x\n", inst, cpu->program_counter);
 }
 
 #endif
\ No newline at end of file
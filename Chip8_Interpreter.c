@@ -0,0 +1,882 @@
+#include "Chip8_Interpreter.h"
+#include "Chip8_Instructions.h"
+#include "Chip8_Decode.h"
+#include "Chip8_JIT.h"
+#include "Chip8_AOT.h"
+#include "Chip8_Profile.h"
+#include "Chip8_Fusion.h"
+
+/* Execution engines, built once per Target_Platform: the Makefile compiles
+   this file with -DCHIP8_SPECIALIZED_TARGET=CHIP8, SCHIPC and XOCHIP, which
+   turns every CPU_TARGET() check in Chip8_Instructions.h into a constant.
+   Everything is static except the Chip8_Interpreter at the end. */
+
+#ifndef CHIP8_SPECIALIZED_TARGET
+#error "Chip8_Interpreter.c must be built with -DCHIP8_SPECIALIZED_TARGET=<Target_Platform>"
+#endif
+
+// Keeps rarely run code such as block building out of the hot loops it is called from.
+#if defined(__GNUC__)
+#define CHIP8_COLD __attribute__((cold, noinline))
+#else
+#define CHIP8_COLD
+#endif
+
+static void aux_0XXX(Chip8_CPU *cpu, WORD inst)
+{
+    WORD aux = ((inst & 0x00E0) == 0x00C0) ? (inst & 0x00F0) : inst;
+    switch (aux & 0x00FF)
+    {
+    case (0x00C0): OP_00CN(cpu,inst); break;
+    case (0x00D0): OP_00DN(cpu,inst); break;
+    case (0x00E0): OP_00E0(cpu, inst); break;
+    case (0x00EE): OP_00EE(cpu, inst); break;
+    case (0x00FB): OP_00FB(cpu,inst); break;
+    case (0x00FC): OP_00FC(cpu,inst); break;
+    case (0x00FD): OP_00FD(cpu,inst); break;
+    case (0x00FE): OP_00FE(cpu,inst); break;
+    case (0x00FF): OP_00FF(cpu,inst); break;
+    default: OP_NULL(cpu, inst); break;
+    }
+}
+
+static void aux_5XYN(Chip8_CPU *cpu, WORD inst)
+{
+    switch ( inst & 0x000F)
+    {
+    case 0x0: OP_5XY0(cpu,inst); break;
+    case 0x2: OP_5XY2(cpu,inst); break;
+    case 0x3: OP_5XY3(cpu,inst); break;
+    default: OP_NULL(cpu,inst); break;
+    }
+}
+
+static void aux_8XYN(Chip8_CPU *cpu, WORD inst)
+{
+    switch ( inst & 0x000F)
+    {
+    case 0x0: OP_8XY0(cpu,inst); break;
+    case 0x1: OP_8XY1(cpu,inst); break;
+    case 0x2: OP_8XY2(cpu,inst); break;
+    case 0x3: OP_8XY3(cpu,inst); break;
+    case 0x4: OP_8XY4(cpu,inst); break;
+    case 0x5: OP_8XY5(cpu,inst); break;
+    case 0x6: OP_8XY6(cpu,inst); break;
+    case 0x7: OP_8XY7(cpu,inst); break;
+    case 0xe: OP_8XYE(cpu,inst); break;
+    default: OP_NULL(cpu,inst); break;
+    }
+    
+}
+
+static void aux_EXYN(Chip8_CPU *cpu, WORD inst)
+{   
+    switch (inst & 0x00FF)
+    {
+    case (0x009E): OP_EX9E(cpu, inst); break;
+    case (0x00A1): OP_EXA1(cpu, inst); break;
+    default: OP_NULL(cpu, inst); break;
+    }
+}
+
+static void aux_FXNN(Chip8_CPU *cpu, WORD inst)
+{
+    switch (inst & 0x00FF)
+    {
+    case 0x00: OP_F000(cpu, inst); break;
+    case 0x01: OP_FN01(cpu, inst); break;
+    case 0x02: OP_F002(cpu, inst); break;
+    case 0x07: OP_FX07(cpu, inst); break;
+    case 0x0A: OP_FX0A(cpu, inst); break;
+    case 0x15: OP_FX15(cpu, inst); break;
+    case 0x18: OP_FX18(cpu, inst); break;
+    case 0x1E: OP_FX1E(cpu, inst); break;
+    case 0x29: OP_FX29(cpu, inst); break;
+    case 0x30: OP_FX30(cpu, inst); break;
+    case 0x33: OP_FX33(cpu, inst); break;
+    case 0x3A: OP_FX3A(cpu, inst); break;
+    case 0x55: OP_FX55(cpu, inst); break;
+    case 0x65: OP_FX65(cpu, inst); break;
+    case 0x75: OP_FX75(cpu, inst); break;
+    case 0x85: OP_FX85(cpu, inst); break;
+    default: OP_NULL(cpu, inst); break;
+    }
+}
+
+static void exec_instruction(Chip8_CPU *cpu)
+{   
+    WORD instruction = read_word(cpu, cpu->program_counter);
+    cpu->program_counter += 2;
+    
+    switch ((instruction & 0xF000) >> 12)
+    {
+    case 0x0: aux_0XXX(cpu,instruction); break;
+    case 0x1: OP_1NNN(cpu,instruction); break;
+    case 0x2: OP_2NNN(cpu,instruction); break;
+    case 0x3: OP_3XNN(cpu,instruction); break;
+    case 0x4: OP_4XNN(cpu,instruction); break;
+    case 0x5: aux_5XYN(cpu,instruction); break;
+    case 0x6: OP_6XNN(cpu,instruction); break;
+    case 0x7: OP_7XNN(cpu,instruction); break;
+    case 0x8: aux_8XYN(cpu,instruction); break;
+    case 0x9: OP_9XY0(cpu,instruction); break;
+    case 0xa: OP_ANNN(cpu,instruction); break;
+    case 0xb: OP_BNNN(cpu,instruction); break;
+    case 0xc: OP_CXNN(cpu,instruction); break;
+    case 0xd: OP_DXYN(cpu,instruction); break;
+    case 0xe: aux_EXYN(cpu,instruction); break;
+    case 0xf: aux_FXNN(cpu,instruction); break;
+    default: OP_NULL(cpu,instruction); break;
+    }
+}
+
+#if CHIP8_DISPATCH == CHIP8_DISPATCH_THREADED
+
+/* Threaded dispatch: every handler jumps straight to the handler of the next
+   instruction through a table of label addresses (GCC labels-as-values), so
+   each opcode costs one indirect jump with its own branch history instead of
+   going through the shared switch in exec_instruction. Second level decodes
+   map the low bits to a small index first to keep the label tables short. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+static const BYTE index_0XXX[256] = {
+    [0xC0] = 1, [0xD0] = 2, [0xE0] = 3, [0xEE] = 4,
+    [0xFB] = 5, [0xFC] = 6, [0xFD] = 7, [0xFE] = 8, [0xFF] = 9};
+
+static const BYTE index_EXNN[256] = {[0x9E] = 1, [0xA1] = 2};
+
+static const BYTE index_FXNN[256] = {
+    [0x00] = 1, [0x01] = 2, [0x02] = 3, [0x07] = 4, [0x0A] = 5, [0x15] = 6,
+    [0x18] = 7, [0x1E] = 8, [0x29] = 9, [0x30] = 10, [0x33] = 11, [0x3A] = 12,
+    [0x55] = 13, [0x65] = 14, [0x75] = 15, [0x85] = 16};
+
+static uint32_t run_interpreter(Chip8_CPU *cpu, uint32_t CPF)
+{
+    static const void *const table_main[16] = {
+        &&op_0XXX, &&op_1NNN, &&op_2NNN, &&op_3XNN, &&op_4XNN, &&op_5XYN, &&op_6XNN, &&op_7XNN,
+        &&op_8XYN, &&op_9XY0, &&op_ANNN, &&op_BNNN, &&op_CXNN, &&op_DXYN, &&op_EXNN, &&op_FXNN};
+    static const void *const table_0XXX[10] = {
+        &&op_NULL, &&op_00CN, &&op_00DN, &&op_00E0, &&op_00EE,
+        &&op_00FB, &&op_00FC, &&op_00FD, &&op_00FE, &&op_00FF};
+    static const void *const table_5XYN[16] = {
+        &&op_5XY0, &&op_NULL, &&op_5XY2, &&op_5XY3, &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL,
+        &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL};
+    static const void *const table_8XYN[16] = {
+        &&op_8XY0, &&op_8XY1, &&op_8XY2, &&op_8XY3, &&op_8XY4, &&op_8XY5, &&op_8XY6, &&op_8XY7,
+        &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL, &&op_NULL, &&op_8XYE, &&op_NULL};
+    static const void *const table_EXNN[3] = {&&op_NULL, &&op_EX9E, &&op_EXA1};
+    static const void *const table_FXNN[17] = {
+        &&op_NULL, &&op_F000, &&op_FN01, &&op_F002, &&op_FX07, &&op_FX0A, &&op_FX15, &&op_FX18, &&op_FX1E,
+        &&op_FX29, &&op_FX30, &&op_FX33, &&op_FX3A, &&op_FX55, &&op_FX65, &&op_FX75, &&op_FX85};
+
+    uint32_t remaining = CPF;
+    WORD inst;
+
+#define DISPATCH()                                                     \
+    do                                                                 \
+    {                                                                  \
+        if (remaining-- == 0)                                          \
+            return CPF;                                                \
+        inst = read_word(cpu, cpu->program_counter);                   \
+        cpu->program_counter += 2;                                     \
+        goto *table_main[inst >> 12];                                  \
+    } while (0)
+
+    DISPATCH();
+
+op_0XXX:
+    goto *table_0XXX[index_0XXX[((inst & 0x00E0) == 0x00C0) ? (inst & 0x00F0) : (inst & 0x00FF)]];
+op_5XYN:
+    goto *table_5XYN[inst & 0x000F];
+op_8XYN:
+    goto *table_8XYN[inst & 0x000F];
+op_EXNN:
+    goto *table_EXNN[index_EXNN[inst & 0x00FF]];
+op_FXNN:
+    goto *table_FXNN[index_FXNN[inst & 0x00FF]];
+
+op_00CN: OP_00CN(cpu, inst); DISPATCH();
+op_00DN: OP_00DN(cpu, inst); DISPATCH();
+op_00E0: OP_00E0(cpu, inst); DISPATCH();
+op_00EE: OP_00EE(cpu, inst); DISPATCH();
+op_00FB: OP_00FB(cpu, inst); DISPATCH();
+op_00FC: OP_00FC(cpu, inst); DISPATCH();
+op_00FD: OP_00FD(cpu, inst); DISPATCH();
+op_00FE: OP_00FE(cpu, inst); DISPATCH();
+op_00FF: OP_00FF(cpu, inst); DISPATCH();
+op_1NNN:
+    OP_1NNN(cpu, inst);
+    if (cpu->idle)
+        return CPF - remaining;
+    DISPATCH();
+op_2NNN: OP_2NNN(cpu, inst); DISPATCH();
+op_3XNN: OP_3XNN(cpu, inst); DISPATCH();
+op_4XNN: OP_4XNN(cpu, inst); DISPATCH();
+op_5XY0: OP_5XY0(cpu, inst); DISPATCH();
+op_5XY2: OP_5XY2(cpu, inst); DISPATCH();
+op_5XY3: OP_5XY3(cpu, inst); DISPATCH();
+op_6XNN: OP_6XNN(cpu, inst); DISPATCH();
+op_7XNN: OP_7XNN(cpu, inst); DISPATCH();
+op_8XY0: OP_8XY0(cpu, inst); DISPATCH();
+op_8XY1: OP_8XY1(cpu, inst); DISPATCH();
+op_8XY2: OP_8XY2(cpu, inst); DISPATCH();
+op_8XY3: OP_8XY3(cpu, inst); DISPATCH();
+op_8XY4: OP_8XY4(cpu, inst); DISPATCH();
+op_8XY5: OP_8XY5(cpu, inst); DISPATCH();
+op_8XY6: OP_8XY6(cpu, inst); DISPATCH();
+op_8XY7: OP_8XY7(cpu, inst); DISPATCH();
+op_8XYE: OP_8XYE(cpu, inst); DISPATCH();
+op_9XY0: OP_9XY0(cpu, inst); DISPATCH();
+op_ANNN: OP_ANNN(cpu, inst); DISPATCH();
+op_BNNN: OP_BNNN(cpu, inst); DISPATCH();
+op_CXNN: OP_CXNN(cpu, inst); DISPATCH();
+op_DXYN: OP_DXYN(cpu, inst); DISPATCH();
+op_EX9E: OP_EX9E(cpu, inst); DISPATCH();
+op_EXA1: OP_EXA1(cpu, inst); DISPATCH();
+op_F000: OP_F000(cpu, inst); DISPATCH();
+op_FN01: OP_FN01(cpu, inst); DISPATCH();
+op_F002: OP_F002(cpu, inst); DISPATCH();
+op_FX07: OP_FX07(cpu, inst); DISPATCH();
+op_FX0A:
+    OP_FX0A(cpu, inst);
+    if (cpu->idle)
+        return CPF - remaining;
+    DISPATCH();
+op_FX15: OP_FX15(cpu, inst); DISPATCH();
+op_FX18: OP_FX18(cpu, inst); DISPATCH();
+op_FX1E: OP_FX1E(cpu, inst); DISPATCH();
+op_FX29: OP_FX29(cpu, inst); DISPATCH();
+op_FX30: OP_FX30(cpu, inst); DISPATCH();
+op_FX33: OP_FX33(cpu, inst); DISPATCH();
+op_FX3A: OP_FX3A(cpu, inst); DISPATCH();
+op_FX55: OP_FX55(cpu, inst); DISPATCH();
+op_FX65: OP_FX65(cpu, inst); DISPATCH();
+op_FX75: OP_FX75(cpu, inst); DISPATCH();
+op_FX85: OP_FX85(cpu, inst); DISPATCH();
+op_NULL: OP_NULL(cpu, inst); DISPATCH();
+
+#undef DISPATCH
+}
+
+#pragma GCC diagnostic pop
+
+#elif CHIP8_DISPATCH == CHIP8_DISPATCH_TABLE
+
+/* Table dispatch: Chip8_Dispatch.h, generated by chip8-dispatch, holds the
+   handler of every one of the 65536 instruction words, so each instruction
+   costs a single indexed call with no second level decode. */
+#define X(op)                                                      \
+    static void dispatch_##op(Chip8_CPU *cpu, WORD inst)           \
+    {                                                              \
+        OP_##op(cpu, inst);                                        \
+    }
+CHIP8_OPCODES(X)
+#undef X
+
+#include "Chip8_Dispatch.h"
+
+static uint32_t run_interpreter(Chip8_CPU *cpu, uint32_t CPF)
+{
+    for (uint32_t i = 0; i < CPF; i++)
+    {
+        if (cpu->idle)
+            return i;
+
+        WORD inst = read_word(cpu, cpu->program_counter);
+        cpu->program_counter += 2;
+        dispatch_table[inst](cpu, inst);
+    }
+    return CPF;
+}
+
+#else
+
+static uint32_t run_interpreter(Chip8_CPU *cpu, uint32_t CPF)
+{
+    for (uint32_t i = 0; i < CPF; i++)
+    {
+        if (cpu->idle)
+            return i;
+        //printf("0x%04x  0x%0x4\n",cpu->game_memory[cpu->program_counter-2],cpu->program_counter-2);
+        exec_instruction(cpu);
+    }
+    return CPF;
+}
+
+#endif
+
+#define X(op)                                                         \
+    static void exec_##op(Chip8_CPU *cpu, const Chip8_Decoded *decoded) \
+    {                                                                 \
+        OP_##op(cpu, decoded->inst);                                  \
+    }
+CHIP8_OPCODES(X)
+#undef X
+
+static const Chip8_Handler opcode_handlers[OPCODE_COUNT] = {
+#define X(op) exec_##op,
+    CHIP8_OPCODES(X)
+#undef X
+};
+
+/* Cached skips: the distance past the next instruction is worked out once
+   by decode_entry, so a taken skip is a single add instead of a look at
+   the next instruction. invalidate_code drops the entry when that
+   instruction is overwritten. */
+#define X(op)                                                               \
+    static void exec_cached_##op(Chip8_CPU *cpu, const Chip8_Decoded *decoded) \
+    {                                                                       \
+        if (skips_##op(cpu, decoded->inst))                                 \
+            cpu->program_counter += decoded->skip;                          \
+    }
+CHIP8_SKIP_OPCODES(X)
+#undef X
+
+static const Chip8_Handler skip_handlers[OPCODE_COUNT] = {
+#define X(op) [OPCODE_##op] = exec_cached_##op,
+    CHIP8_SKIP_OPCODES(X)
+#undef X
+};
+
+// Handler of a cache entry for `opcode`: the cached variant for skips, the plain one otherwise.
+static inline Chip8_Handler decoded_handler(Chip8_Opcode opcode)
+{
+    return (skip_handlers[opcode] != NULL) ? skip_handlers[opcode] : opcode_handlers[opcode];
+}
+
+// 1NNN and FX0A are the only instructions that set cpu->idle.
+static inline int opcode_may_idle(Chip8_Opcode opcode)
+{
+    return opcode == OPCODE_1NNN || opcode == OPCODE_FX0A;
+}
+
+static void decode_entry(Chip8_CPU *cpu, Chip8_Decoded *decoded, WORD address)
+{
+    Chip8_Opcode opcode;
+
+    decoded->inst = read_word(cpu, address);
+    opcode = decode_opcode(decoded->inst);
+    decoded->handler = decoded_handler(opcode);
+    decoded->op = ENTRY_OPCODE + opcode;
+    decoded->length = 1;
+    decoded->skip = (skip_handlers[opcode] != NULL) ? skip_distance(cpu, address + 2) : 0;
+}
+
+/* Superinstructions: the sequences listed in Chip8_Fusion.h run as a single
+   handler. Every instruction but the last one of a sequence is a block body
+   instruction, so the program counter simply moves on to the next one. The
+   caller has already advanced the program counter past the first one. The
+   last one, which may be a skip, runs through its cache entry handler. */
+#define X(a, b)                                                       \
+    static void fused_##a##_##b(Chip8_CPU *cpu, const Chip8_Decoded *op) \
+    {                                                                 \
+        OP_##a(cpu, op[0].inst);                                      \
+        cpu->program_counter += 2;                                    \
+        decoded_handler(OPCODE_##b)(cpu, &op[1]);                     \
+    }
+CHIP8_FUSED_PAIRS(X)
+#undef X
+
+#define X(a, b, c)                                                            \
+    static void fused_##a##_##b##_##c(Chip8_CPU *cpu, const Chip8_Decoded *op) \
+    {                                                                         \
+        OP_##a(cpu, op[0].inst);                                              \
+        cpu->program_counter += 2;                                            \
+        OP_##b(cpu, op[1].inst);                                              \
+        cpu->program_counter += 2;                                            \
+        decoded_handler(OPCODE_##c)(cpu, &op[2]);                             \
+    }
+CHIP8_FUSED_TRIPLES(X)
+#undef X
+
+typedef struct
+{
+    Chip8_Opcode opcodes[3];
+    BYTE length;
+    Chip8_Handler handler;
+} Fused_Sequence;
+
+// Triples first so they win over a pair with the same prefix.
+static const Fused_Sequence fused_sequences[] = {
+#define X(a, b, c) {{OPCODE_##a, OPCODE_##b, OPCODE_##c}, 3, fused_##a##_##b##_##c},
+    CHIP8_FUSED_TRIPLES(X)
+#undef X
+#define X(a, b) {{OPCODE_##a, OPCODE_##b, OPCODE_NULL}, 2, fused_##a##_##b},
+    CHIP8_FUSED_PAIRS(X)
+#undef X
+    {{OPCODE_NULL, OPCODE_NULL, OPCODE_NULL}, 0, NULL}};
+
+// Replaces the handlers of the block instructions that start a known sequence with the fused one.
+static void fuse_block(Chip8_Decoded *block, BYTE length)
+{
+    for (BYTE i = 0; i + 1 < length; i++)
+    {
+        for (const Fused_Sequence *sequence = fused_sequences; sequence->handler != NULL; sequence++)
+        {
+            BYTE n = 0;
+
+            while (n < sequence->length && i + n < length && decode_opcode(block[i + n].inst) == sequence->opcodes[n])
+                n++;
+
+            if (n == sequence->length)
+            {
+                block[i].handler = sequence->handler;
+                block[i].op = ENTRY_HANDLER;
+                block[i].length = sequence->length;
+                break;
+            }
+        }
+    }
+}
+
+/* Predecode engine that also records every instruction in cpu->profile.
+   Superinstructions are never used here so the profile sees each opcode. */
+static uint32_t run_profiled(Chip8_CPU *cpu, uint32_t CPF)
+{
+    for (uint32_t i = 0; i < CPF; i++)
+    {
+        WORD pc = cpu->program_counter & (memory_size(cpu) - 1);
+
+        if (cpu->idle)
+            return i;
+
+        if (pc & 1)
+        {
+            profile_break(cpu->profile);
+            exec_instruction(cpu);
+            continue;
+        }
+
+        Chip8_Decoded *decoded = &cpu->decode_cache[pc >> 1];
+        if (decoded->handler == NULL)
+            decode_entry(cpu, decoded, pc);
+
+        Chip8_Opcode opcode = decode_opcode(decoded->inst);
+        profile_record(cpu->profile, opcode);
+        cpu->program_counter = pc + 2;
+        opcode_handlers[opcode](cpu, decoded);
+    }
+    return CPF;
+}
+
+CHIP8_COLD static void build_block(Chip8_CPU *cpu, uint32_t address)
+{
+    Chip8_Decoded *block = &cpu->decode_cache[address >> 1];
+    BYTE length = 0;
+    int ends_block;
+
+    do
+    {
+        Chip8_Decoded *decoded = &block[length];
+        if (decoded->handler == NULL)
+            decode_entry(cpu, decoded, address);
+
+        ends_block = opcode_ends_block(decode_opcode(decoded->inst));
+        address += 2;
+        length++;
+    } while (!ends_block && length < CHIP8_MAX_BLOCK_LENGTH && address < memory_size(cpu));
+
+    block->block_length = length;
+    fuse_block(block, length);
+}
+
+/* Runs the straight-line block cached for the current address in one go.
+   Only as many instructions as are left in the frame budget are executed,
+   so a block cut short simply resumes from the middle next frame. Returns
+   the number of instructions executed. */
+static uint32_t exec_block(Chip8_CPU *cpu, uint32_t remaining)
+{
+    WORD pc = cpu->program_counter & (memory_size(cpu) - 1);
+
+    if (pc & 1)
+    {
+        exec_instruction(cpu);
+        return 1;
+    }
+
+    Chip8_Decoded *block = &cpu->decode_cache[pc >> 1];
+    if (block->block_length == 0)
+        build_block(cpu, pc);
+
+    uint32_t length = block->block_length;
+    uint32_t i = 0;
+
+    /* A superinstruction can only run past the end of a block that was cut
+       at CHIP8_MAX_BLOCK_LENGTH, by 2 instructions at most. With that much
+       budget left the block runs without checking. */
+    if (length + 2 <= remaining)
+    {
+        do
+        {
+            cpu->program_counter = pc + 2;
+            block[i].handler(cpu, &block[i]);
+            pc += 2 * block[i].length;
+            i += block[i].length;
+        } while (i < length);
+
+        return i;
+    }
+
+    length = (length < remaining) ? length : remaining;
+
+    while (i < length)
+    {
+        Chip8_Handler handler = block[i].handler;
+        BYTE count = block[i].length;
+
+        // A superinstruction cut short by the block end or the budget runs its first instruction alone.
+        if (i + count > length)
+        {
+            handler = opcode_handlers[decode_opcode(block[i].inst)];
+            count = 1;
+        }
+
+        cpu->program_counter = pc + 2;
+        handler(cpu, &block[i]);
+        pc += 2 * count;
+        i += count;
+    }
+
+    return length;
+}
+
+#if CHIP8_DISPATCH == CHIP8_DISPATCH_THREADED
+
+/* Threaded cached engines: the `op` of a cache entry indexes a table of label
+   addresses, so each instruction costs one indirect jump to a label where
+   its entry handler is inlined. The decoder and superinstructions are
+   labels too, which keeps any check for them out of the common path. */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+
+/* Predecode engine: instructions at even addresses are decoded once into the
+   cache and then executed straight from their entry. write_memory drops the
+   entry whenever the ROM overwrites it. Odd addresses are never cached.
+   After an instruction that cannot end a block, the next entry is the
+   following one, without reading the program counter back. */
+static uint32_t run_predecoded(Chip8_CPU *cpu, uint32_t CPF)
+{
+    static const void *const labels[ENTRY_OPCODE + OPCODE_COUNT] = {
+        [ENTRY_UNDECODED] = &&decode,
+        [ENTRY_HANDLER] = &&handler,
+#define X(op) [ENTRY_OPCODE + OPCODE_##op] = &&op_##op,
+        CHIP8_OPCODES(X)
+#undef X
+    };
+    uint32_t remaining = CPF;
+    Chip8_Decoded *decoded;
+    WORD pc;
+
+    if (cpu->idle)
+        return 0;
+
+#define DISPATCH()                                          \
+    do                                                      \
+    {                                                       \
+        if (remaining == 0)                                 \
+            return CPF;                                     \
+        pc = cpu->program_counter & (memory_size(cpu) - 1); \
+        if (pc & 1)                                         \
+            goto odd;                                       \
+        decoded = &cpu->decode_cache[pc >> 1];              \
+        cpu->program_counter = pc + 2;                      \
+        remaining--;                                        \
+        goto *labels[decoded->op];                          \
+    } while (0)
+
+#define NEXT()                                  \
+    do                                          \
+    {                                           \
+        if (remaining == 0)                     \
+            return CPF;                         \
+        pc = (pc + 2) & (memory_size(cpu) - 1); \
+        decoded = &cpu->decode_cache[pc >> 1];  \
+        cpu->program_counter = pc + 2;          \
+        remaining--;                            \
+        goto *labels[decoded->op];              \
+    } while (0)
+
+    DISPATCH();
+
+decode:
+    decode_entry(cpu, decoded, pc);
+    goto *labels[decoded->op];
+handler:
+    // A superinstruction cut short by the budget runs its first instruction alone.
+    if (decoded->length > remaining + 1)
+    {
+        opcode_handlers[decode_opcode(decoded->inst)](cpu, decoded);
+        DISPATCH();
+    }
+    decoded->handler(cpu, decoded);
+    remaining -= decoded->length - 1;
+    DISPATCH();
+odd:
+    remaining--;
+    exec_instruction(cpu);
+    if (cpu->idle)
+        return CPF - remaining;
+    DISPATCH();
+
+#define X(op)                                      \
+    op_##op:                                       \
+    decoded_handler(OPCODE_##op)(cpu, decoded);    \
+    if (opcode_may_idle(OPCODE_##op) && cpu->idle) \
+        return CPF - remaining;                    \
+    if (opcode_ends_block(OPCODE_##op))            \
+        DISPATCH();                                \
+    NEXT();
+    CHIP8_OPCODES(X)
+#undef X
+
+#undef NEXT
+#undef DISPATCH
+}
+
+/* Block engine: runs the straight-line block cached for the current address
+   in one go. The budget is checked once per block, and inside it the next
+   entry is simply the following one, as only the last instruction of a
+   block can jump, skip or write memory. Blocks that are not built yet, or
+   longer than what is left of the budget, go through exec_block. */
+static uint32_t run_blocks(Chip8_CPU *cpu, uint32_t CPF)
+{
+    static const void *const labels[ENTRY_OPCODE + OPCODE_COUNT] = {
+        [ENTRY_UNDECODED] = &&decode,
+        [ENTRY_HANDLER] = &&handler,
+#define X(op) [ENTRY_OPCODE + OPCODE_##op] = &&op_##op,
+        CHIP8_OPCODES(X)
+#undef X
+    };
+    uint32_t remaining = CPF;
+    uint32_t left; // Instructions of the current block not run yet, this one included.
+    Chip8_Decoded *decoded;
+    WORD pc;
+
+    if (cpu->idle)
+        return 0;
+
+#define NEXT_BLOCK()                                                                     \
+    do                                                                                   \
+    {                                                                                    \
+        if (remaining == 0)                                                              \
+            return CPF;                                                                  \
+        pc = cpu->program_counter & (memory_size(cpu) - 1);                              \
+        decoded = &cpu->decode_cache[pc >> 1];                                           \
+        left = decoded->block_length;                                                    \
+        /* See exec_block for the 2 spare instructions. */                               \
+        if ((pc & 1) || left == 0 || left + 2 > remaining)                               \
+            goto tail;                                                                   \
+        remaining -= left;                                                               \
+        cpu->program_counter = pc + 2;                                                   \
+        goto *labels[decoded->op];                                                       \
+    } while (0)
+
+#define NEXT()                             \
+    do                                     \
+    {                                      \
+        if (--left == 0)                   \
+            NEXT_BLOCK();                  \
+        decoded++;                         \
+        pc += 2;                           \
+        cpu->program_counter = pc + 2;     \
+        goto *labels[decoded->op];         \
+    } while (0)
+
+    NEXT_BLOCK();
+
+decode:
+    decode_entry(cpu, decoded, pc);
+    goto *labels[decoded->op];
+handler:
+    decoded->handler(cpu, decoded);
+    // Fused by an overlapping block, a superinstruction may run past the end of this one.
+    if (decoded->length >= left)
+    {
+        remaining -= decoded->length - left;
+        NEXT_BLOCK();
+    }
+    left -= decoded->length - 1;
+    pc += 2 * (decoded->length - 1);
+    decoded += decoded->length - 1;
+    NEXT();
+tail:
+    remaining -= exec_block(cpu, remaining);
+    if (cpu->idle)
+        return CPF - remaining;
+    NEXT_BLOCK();
+
+#define X(op)                                      \
+    op_##op:                                       \
+    decoded_handler(OPCODE_##op)(cpu, decoded);    \
+    if (opcode_may_idle(OPCODE_##op) && cpu->idle) \
+        return CPF - remaining;                    \
+    if (opcode_ends_block(OPCODE_##op))            \
+        NEXT_BLOCK();                              \
+    NEXT();
+    CHIP8_OPCODES(X)
+#undef X
+
+#undef NEXT
+#undef NEXT_BLOCK
+}
+
+#pragma GCC diagnostic pop
+
+#else
+
+/* Predecode engine: instructions at even addresses are decoded once into the
+   cache and then executed straight from their entry. write_memory drops the
+   entry whenever the ROM overwrites it. Odd addresses are never cached. */
+static uint32_t run_predecoded(Chip8_CPU *cpu, uint32_t CPF)
+{
+    for (uint32_t i = 0; i < CPF; i++)
+    {
+        WORD pc = cpu->program_counter & (memory_size(cpu) - 1);
+
+        if (cpu->idle)
+            return i;
+
+        if (pc & 1)
+        {
+            exec_instruction(cpu);
+            continue;
+        }
+
+        Chip8_Decoded *decoded = &cpu->decode_cache[pc >> 1];
+        cpu->program_counter = pc + 2;
+
+        switch (decoded->op)
+        {
+        case ENTRY_UNDECODED:
+            decode_entry(cpu, decoded, pc);
+            decoded->handler(cpu, decoded);
+            break;
+        case ENTRY_HANDLER:
+            // A superinstruction cut short by the budget runs its first instruction alone.
+            if (decoded->length > CPF - i)
+            {
+                opcode_handlers[decode_opcode(decoded->inst)](cpu, decoded);
+                break;
+            }
+            decoded->handler(cpu, decoded);
+            i += decoded->length - 1;
+            break;
+#define X(op)                                           \
+        case ENTRY_OPCODE + OPCODE_##op:                \
+            decoded_handler(OPCODE_##op)(cpu, decoded); \
+            break;
+        CHIP8_OPCODES(X)
+#undef X
+        }
+    }
+    return CPF;
+}
+
+/* Block engine: runs the straight-line block cached for the current address
+   in one go, with the budget checked once per block. Blocks that are not
+   built yet, or longer than what is left of the budget, go through
+   exec_block. */
+static uint32_t run_blocks(Chip8_CPU *cpu, uint32_t CPF)
+{
+    uint32_t remaining = CPF;
+
+    while (remaining > 0 && !cpu->idle)
+    {
+        WORD pc = cpu->program_counter & (memory_size(cpu) - 1);
+        Chip8_Decoded *decoded = &cpu->decode_cache[pc >> 1];
+        uint32_t left = decoded->block_length;
+
+        // See exec_block for the 2 spare instructions.
+        if ((pc & 1) || left == 0 || left + 2 > remaining)
+        {
+            remaining -= exec_block(cpu, remaining);
+            continue;
+        }
+
+        remaining -= left;
+        while (left > 0)
+        {
+            cpu->program_counter = pc + 2;
+
+            switch (decoded->op)
+            {
+            case ENTRY_UNDECODED:
+                decode_entry(cpu, decoded, pc);
+                continue;
+            case ENTRY_HANDLER:
+                decoded->handler(cpu, decoded);
+                // Fused by an overlapping block, a superinstruction may run past the end of this one.
+                if (decoded->length > left)
+                    remaining -= decoded->length - left;
+                left = (decoded->length < left) ? left - decoded->length : 0;
+                pc += 2 * decoded->length;
+                decoded += decoded->length;
+                continue;
+#define X(op)                                               \
+            case ENTRY_OPCODE + OPCODE_##op:                \
+                decoded_handler(OPCODE_##op)(cpu, decoded); \
+                break;
+            CHIP8_OPCODES(X)
+#undef X
+            }
+
+            left--;
+            pc += 2;
+            decoded++;
+        }
+    }
+    return CPF - remaining;
+}
+
+#endif
+
+// JIT engine: native blocks where available, the block engine for everything else.
+static uint32_t run_native(Chip8_CPU *cpu, uint32_t CPF)
+{
+    uint32_t remaining = CPF;
+
+    if (cpu->jit == NULL)
+        cpu->jit = jit_create();
+
+    while (remaining > 0 && !cpu->idle)
+    {
+        uint32_t executed = jit_exec(cpu->jit, cpu, remaining);
+        if (executed == 0)
+            executed = exec_block(cpu, remaining);
+        remaining -= executed;
+    }
+    return CPF - remaining;
+}
+
+// AOT engine: compiled blocks from cpu->aot where available, the block engine for everything else.
+static uint32_t run_compiled(Chip8_CPU *cpu, uint32_t CPF)
+{
+    uint32_t remaining = CPF;
+
+    while (remaining > 0 && !cpu->idle)
+    {
+        const Chip8_AOT_Block *block = aot_lookup(cpu->aot, cpu->program_counter & (memory_size(cpu) - 1));
+
+        if (block != NULL && block->length <= remaining)
+        {
+            block->run(cpu);
+            remaining -= block->length;
+        }
+        else
+        {
+            remaining -= exec_block(cpu, remaining);
+        }
+    }
+    return CPF - remaining;
+}
+
+const Chip8_Interpreter INTERPRETER_NAME(CHIP8_SPECIALIZED_TARGET) = {
+    .run = {
+        [ENGINE_INTERPRETER] = run_interpreter,
+        [ENGINE_PREDECODE] = run_predecoded,
+        [ENGINE_BLOCK] = run_blocks,
+        [ENGINE_JIT] = run_native,
+        [ENGINE_AOT] = run_compiled},
+    .run_profiled = run_profiled,
+    .decode = decode_entry};
@@ -0,0 +1,22 @@
+#ifndef CHIP8_INTERPRETER_H
+#define CHIP8_INTERPRETER_H 1
+
+#include "Chip8_CPU.h"
+
+// Execution engines and opcode handlers specialized for one Target_Platform.
+struct Chip8_Interpreter
+{
+    // Each returns the number of instructions executed, less than CPF if the CPU went idle.
+    uint32_t (*run[ENGINE_COUNT])(Chip8_CPU *cpu, uint32_t CPF);
+    uint32_t (*run_profiled)(Chip8_CPU *cpu, uint32_t CPF); // Used instead of `run` while recording a profile.
+    void (*decode)(Chip8_CPU *cpu, Chip8_Decoded *decoded, WORD address); // Fills the cache entry of `address`.
+};
+
+#define INTERPRETER_NAME_(target) interpreter_##target
+#define INTERPRETER_NAME(target) INTERPRETER_NAME_(target)
+
+extern const Chip8_Interpreter interpreter_CHIP8;
+extern const Chip8_Interpreter interpreter_SCHIPC;
+extern const Chip8_Interpreter interpreter_XOCHIP;
+
+#endif
@@ -0,0 +1,707 @@
+#include "Chip8_JIT.h"
+#include "Chip8_Decode.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include <stddef.h>
+#include <sys/mman.h>
+
+#define JIT_FAILED ((BYTE *)1)
+#define JIT_MAX_BLOCK_CODE 4096
+
+typedef void (*Chip8_Native)(Chip8_CPU *cpu);
+
+// x86-64 register numbers.
+enum
+{
+    RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+    R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/* Inside a block rdi holds the Chip8_CPU pointer, eax is scratch and ecx
+   holds I. V registers get a host register from the pool on first use and
+   live there until the block exits. PC is known at compile time, so it is
+   only stored on exit. */
+static const BYTE register_pool[] = {RDX, RSI, R8, R9, R10, R11, RBX, RBP, R12, R13, R14, R15};
+
+#define POOL_SIZE (sizeof(register_pool) / sizeof(register_pool[0]))
+
+struct Chip8_JIT
+{
+    BYTE *code;
+    size_t used;
+    uint32_t compiled;
+    BYTE *native[CHIP8_DECODE_CACHE_SIZE];
+    BYTE length[CHIP8_DECODE_CACHE_SIZE];
+    BYTE hits[CHIP8_DECODE_CACHE_SIZE];
+};
+
+typedef struct
+{
+    BYTE *out;
+    int8_t host[16];
+    uint16_t written;
+    BYTE pool_used;
+    BYTE writes_i;
+} Block_Compiler;
+
+#define OFFSET_V(x) ((int32_t)(offsetof(Chip8_CPU, game_registers) + (x)))
+#define OFFSET_I ((int32_t)offsetof(Chip8_CPU, i_register))
+#define OFFSET_PC ((int32_t)offsetof(Chip8_CPU, program_counter))
+#define OFFSET_KEYS ((int32_t)offsetof(Chip8_CPU, keys))
+#define OFFSET_DELAY ((int32_t)offsetof(Chip8_CPU, delay_timer))
+#define OFFSET_SOUND ((int32_t)offsetof(Chip8_CPU, sound_timer))
+#define OFFSET_MEMORY ((int32_t)offsetof(Chip8_CPU, game_memory))
+
+/* ---------------------------------------------------------------------------
+   Instruction encoding. Everything works on 32 bit registers holding values
+   in 0..255 (V registers) or 0..0xFFFF (I), memory operands are [rdi+disp32].
+   ------------------------------------------------------------------------ */
+
+static void emit_byte(Block_Compiler *bc, BYTE value)
+{
+    *bc->out++ = value;
+}
+
+static void emit_u16(Block_Compiler *bc, WORD value)
+{
+    emit_byte(bc, value & 0xFF);
+    emit_byte(bc, value >> 8);
+}
+
+static void emit_u32(Block_Compiler *bc, uint32_t value)
+{
+    emit_u16(bc, value & 0xFFFF);
+    emit_u16(bc, value >> 16);
+}
+
+static void emit_rex(Block_Compiler *bc, int reg, int index, int base, int force)
+{
+    BYTE rex = 0x40 | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+    if (rex != 0x40 || force)
+        emit_byte(bc, rex);
+}
+
+static void emit_modrm(Block_Compiler *bc, int mod, int reg, int rm)
+{
+    emit_byte(bc, (mod << 6) | ((reg & 7) << 3) | (rm & 7));
+}
+
+// <op> [rdi + disp], reg
+static void emit_mem(Block_Compiler *bc, int reg, int32_t disp)
+{
+    emit_modrm(bc, 2, reg, RDI);
+    emit_u32(bc, (uint32_t)disp);
+}
+
+// mov dst, imm32
+static void emit_mov_imm(Block_Compiler *bc, int dst, uint32_t imm)
+{
+    emit_rex(bc, 0, 0, dst, 0);
+    emit_byte(bc, 0xB8 + (dst & 7));
+    emit_u32(bc, imm);
+}
+
+// <opcode> dst, src with the "r/m32, r32" encodings (mov 0x89, add 0x01, sub 0x29, or 0x09, and 0x21, xor 0x31, cmp 0x39).
+static void emit_alu(Block_Compiler *bc, BYTE opcode, int dst, int src)
+{
+    emit_rex(bc, src, 0, dst, 0);
+    emit_byte(bc, opcode);
+    emit_modrm(bc, 3, src, dst);
+}
+
+// <op> dst, imm32 (add /0, or /1, and /4, sub /5, xor /6, cmp /7).
+static void emit_alu_imm(Block_Compiler *bc, int ext, int dst, uint32_t imm)
+{
+    emit_rex(bc, 0, 0, dst, 0);
+    emit_byte(bc, 0x81);
+    emit_modrm(bc, 3, ext, dst);
+    emit_u32(bc, imm);
+}
+
+// shl (/4) or shr (/5) dst, imm8.
+static void emit_shift(Block_Compiler *bc, int ext, int dst, BYTE amount)
+{
+    emit_rex(bc, 0, 0, dst, 0);
+    emit_byte(bc, 0xC1);
+    emit_modrm(bc, 3, ext, dst);
+    emit_byte(bc, amount);
+}
+
+// movzx dst, byte [rdi + disp]
+static void emit_load_byte(Block_Compiler *bc, int dst, int32_t disp)
+{
+    emit_rex(bc, dst, 0, 0, 0);
+    emit_byte(bc, 0x0F);
+    emit_byte(bc, 0xB6);
+    emit_mem(bc, dst, disp);
+}
+
+// mov byte [rdi + disp], src (REX is always emitted so sil/dil/bpl are encodable).
+static void emit_store_byte(Block_Compiler *bc, int src, int32_t disp)
+{
+    emit_rex(bc, src, 0, 0, 1);
+    emit_byte(bc, 0x88);
+    emit_mem(bc, src, disp);
+}
+
+// movzx dst, word [rdi + disp]
+static void emit_load_word(Block_Compiler *bc, int dst, int32_t disp)
+{
+    emit_rex(bc, dst, 0, 0, 0);
+    emit_byte(bc, 0x0F);
+    emit_byte(bc, 0xB7);
+    emit_mem(bc, dst, disp);
+}
+
+// mov word [rdi + disp], src
+static void emit_store_word(Block_Compiler *bc, int src, int32_t disp)
+{
+    emit_byte(bc, 0x66);
+    emit_rex(bc, src, 0, 0, 0);
+    emit_byte(bc, 0x89);
+    emit_mem(bc, src, disp);
+}
+
+// mov word [rdi + disp], imm16
+static void emit_store_word_imm(Block_Compiler *bc, int32_t disp, WORD imm)
+{
+    emit_byte(bc, 0x66);
+    emit_byte(bc, 0xC7);
+    emit_mem(bc, 0, disp);
+    emit_u16(bc, imm);
+}
+
+// cmp word [rdi + disp], imm16
+static void emit_cmp_word_imm(Block_Compiler *bc, int32_t disp, WORD imm)
+{
+    emit_byte(bc, 0x66);
+    emit_byte(bc, 0x81);
+    emit_mem(bc, 7, disp);
+    emit_u16(bc, imm);
+}
+
+// movzx eax, byte [rdi + index + disp]
+static void emit_load_byte_indexed(Block_Compiler *bc, int index, int32_t disp)
+{
+    emit_rex(bc, 0, index, 0, 0);
+    emit_byte(bc, 0x0F);
+    emit_byte(bc, 0xB6);
+    emit_modrm(bc, 2, RAX, 4);
+    emit_byte(bc, ((index & 7) << 3) | RDI);
+    emit_u32(bc, (uint32_t)disp);
+}
+
+// lea ecx, [src + src * 4 + disp]
+static void emit_lea_times5(Block_Compiler *bc, int src, int32_t disp)
+{
+    emit_rex(bc, 0, src, src, 0);
+    emit_byte(bc, 0x8D);
+    emit_modrm(bc, 2, RCX, 4);
+    emit_byte(bc, (2 << 6) | ((src & 7) << 3) | (src & 7));
+    emit_u32(bc, (uint32_t)disp);
+}
+
+static void emit_push(Block_Compiler *bc, int reg)
+{
+    emit_rex(bc, 0, 0, reg, 0);
+    emit_byte(bc, 0x50 + (reg & 7));
+}
+
+static void emit_pop(Block_Compiler *bc, int reg)
+{
+    emit_rex(bc, 0, 0, reg, 0);
+    emit_byte(bc, 0x58 + (reg & 7));
+}
+
+static int is_callee_saved(int reg)
+{
+    return reg == RBX || reg == RBP || reg >= R12;
+}
+
+/* ---------------------------------------------------------------------------
+   Block translation.
+   ------------------------------------------------------------------------ */
+
+static int translatable(Chip8_Opcode opcode, Target_Platform target)
+{
+    switch (opcode)
+    {
+    case OPCODE_1NNN:
+    case OPCODE_3XNN:
+    case OPCODE_4XNN:
+    case OPCODE_5XY0:
+    case OPCODE_6XNN:
+    case OPCODE_7XNN:
+    case OPCODE_8XY0:
+    case OPCODE_8XY1:
+    case OPCODE_8XY2:
+    case OPCODE_8XY3:
+    case OPCODE_8XY4:
+    case OPCODE_8XY5:
+    case OPCODE_8XY6:
+    case OPCODE_8XY7:
+    case OPCODE_8XYE:
+    case OPCODE_9XY0:
+    case OPCODE_ANNN:
+    case OPCODE_EX9E:
+    case OPCODE_EXA1:
+    case OPCODE_FX07:
+    case OPCODE_FX15:
+    case OPCODE_FX18:
+    case OPCODE_FX1E:
+    case OPCODE_FX29:
+        return 1;
+    case OPCODE_FX30:
+        return target != CHIP8;
+    default:
+        return 0;
+    }
+}
+
+// Shift source of 8XY6/8XYE, see OP_8XY6.
+static BYTE shift_source(WORD inst, Target_Platform target)
+{
+    return (target == SCHIPC) ? (inst & 0x0F00) >> 8 : (inst & 0x00F0) >> 4;
+}
+
+// V registers an instruction touches.
+static int registers_used(Chip8_Opcode opcode, WORD inst, Target_Platform target, BYTE *regs)
+{
+    BYTE x = (inst & 0x0F00) >> 8;
+    BYTE y = (inst & 0x00F0) >> 4;
+
+    switch (opcode)
+    {
+    case OPCODE_1NNN:
+    case OPCODE_ANNN:
+        return 0;
+    case OPCODE_5XY0:
+    case OPCODE_8XY0:
+    case OPCODE_9XY0:
+        regs[0] = x;
+        regs[1] = y;
+        return 2;
+    case OPCODE_8XY1:
+    case OPCODE_8XY2:
+    case OPCODE_8XY3:
+        regs[0] = x;
+        regs[1] = y;
+        regs[2] = 0xF;
+        return (target == CHIP8) ? 3 : 2;
+    case OPCODE_8XY4:
+    case OPCODE_8XY5:
+    case OPCODE_8XY7:
+        regs[0] = x;
+        regs[1] = y;
+        regs[2] = 0xF;
+        return 3;
+    case OPCODE_8XY6:
+    case OPCODE_8XYE:
+        regs[0] = x;
+        regs[1] = shift_source(inst, target);
+        regs[2] = 0xF;
+        return 3;
+    default:
+        regs[0] = x;
+        return 1;
+    }
+}
+
+// Gives every register in `regs` a host register, or fails without changes if the pool runs out.
+static int reserve_registers(Block_Compiler *bc, const BYTE *regs, int count)
+{
+    int needed = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int seen = 0;
+        for (int j = 0; j < i; j++)
+            seen |= (regs[j] == regs[i]);
+        if (!seen && bc->host[regs[i]] < 0)
+            needed++;
+    }
+
+    if (bc->pool_used + needed > (int)POOL_SIZE)
+        return 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (bc->host[regs[i]] < 0)
+            bc->host[regs[i]] = register_pool[bc->pool_used++];
+    }
+    return 1;
+}
+
+#define VREG(x) (bc->host[(x)])
+#define WRITE_V(x) (bc->written |= (1 << (x)))
+
+// Exit through a skip: PC is left at `next` when the `jump_if_no_skip` branch is taken, past it otherwise.
+static void emit_skip(Block_Compiler *bc, BYTE jump_if_no_skip, WORD next, int long_skip)
+{
+    emit_store_word_imm(bc, OFFSET_PC, next);
+    emit_byte(bc, jump_if_no_skip);
+    BYTE *rel = bc->out++;
+    BYTE *start = bc->out;
+
+    emit_store_word_imm(bc, OFFSET_PC, next + 2);
+    if (long_skip)
+    {
+        // XO-CHIP skips the whole 4 byte F000 instruction. Checked at runtime so later writes to `next` are honoured.
+        emit_cmp_word_imm(bc, OFFSET_MEMORY + next, 0x00F0);
+        emit_byte(bc, 0x75);
+        emit_byte(bc, 9);
+        emit_store_word_imm(bc, OFFSET_PC, next + 4);
+    }
+
+    *rel = (BYTE)(bc->out - start);
+}
+
+static void emit_instruction(Block_Compiler *bc, Chip8_Opcode opcode, WORD inst, WORD next, Target_Platform target)
+{
+    BYTE x = (inst & 0x0F00) >> 8;
+    BYTE y = (inst & 0x00F0) >> 4;
+    BYTE nn = inst & 0x00FF;
+    int long_skip = (target == XOCHIP);
+
+    switch (opcode)
+    {
+    case OPCODE_1NNN:
+        emit_store_word_imm(bc, OFFSET_PC, inst & 0x0FFF);
+        break;
+    case OPCODE_3XNN:
+        emit_alu_imm(bc, 7, VREG(x), nn);
+        emit_skip(bc, 0x75, next, long_skip);
+        break;
+    case OPCODE_4XNN:
+        emit_alu_imm(bc, 7, VREG(x), nn);
+        emit_skip(bc, 0x74, next, long_skip);
+        break;
+    case OPCODE_5XY0:
+        emit_alu(bc, 0x39, VREG(x), VREG(y));
+        emit_skip(bc, 0x75, next, long_skip);
+        break;
+    case OPCODE_9XY0:
+        emit_alu(bc, 0x39, VREG(x), VREG(y));
+        emit_skip(bc, 0x74, next, long_skip);
+        break;
+    case OPCODE_EX9E:
+        emit_load_byte_indexed(bc, VREG(x), OFFSET_KEYS);
+        emit_alu(bc, 0x85, RAX, RAX);
+        emit_skip(bc, 0x74, next, long_skip);
+        break;
+    case OPCODE_EXA1:
+        emit_load_byte_indexed(bc, VREG(x), OFFSET_KEYS);
+        emit_alu(bc, 0x85, RAX, RAX);
+        emit_skip(bc, 0x75, next, long_skip);
+        break;
+    case OPCODE_6XNN:
+        emit_mov_imm(bc, VREG(x), nn);
+        WRITE_V(x);
+        break;
+    case OPCODE_7XNN:
+        emit_alu_imm(bc, 0, VREG(x), nn);
+        emit_alu_imm(bc, 4, VREG(x), 0xFF);
+        WRITE_V(x);
+        break;
+    case OPCODE_8XY0:
+        emit_alu(bc, 0x89, VREG(x), VREG(y));
+        WRITE_V(x);
+        break;
+    case OPCODE_8XY1:
+    case OPCODE_8XY2:
+    case OPCODE_8XY3:
+        emit_alu(bc, (opcode == OPCODE_8XY1) ? 0x09 : (opcode == OPCODE_8XY2) ? 0x21 : 0x31, VREG(x), VREG(y));
+        WRITE_V(x);
+        if (target == CHIP8)
+        {
+            emit_mov_imm(bc, VREG(0xF), 0);
+            WRITE_V(0xF);
+        }
+        break;
+    case OPCODE_8XY4:
+        // eax = VX + VY, VX = eax & 0xFF, VF = eax >> 8.
+        emit_alu(bc, 0x89, RAX, VREG(x));
+        emit_alu(bc, 0x01, RAX, VREG(y));
+        emit_alu(bc, 0x89, VREG(x), RAX);
+        emit_alu_imm(bc, 4, VREG(x), 0xFF);
+        emit_shift(bc, 5, RAX, 8);
+        emit_alu(bc, 0x89, VREG(0xF), RAX);
+        WRITE_V(x);
+        WRITE_V(0xF);
+        break;
+    case OPCODE_8XY5:
+    case OPCODE_8XY7:
+        // eax = minuend - subtrahend, the sign bit is the borrow, VF = !borrow.
+        emit_alu(bc, 0x89, RAX, (opcode == OPCODE_8XY5) ? VREG(x) : VREG(y));
+        emit_alu(bc, 0x29, RAX, (opcode == OPCODE_8XY5) ? VREG(y) : VREG(x));
+        emit_alu(bc, 0x89, VREG(x), RAX);
+        emit_alu_imm(bc, 4, VREG(x), 0xFF);
+        emit_shift(bc, 5, RAX, 31);
+        emit_alu_imm(bc, 6, RAX, 1);
+        emit_alu(bc, 0x89, VREG(0xF), RAX);
+        WRITE_V(x);
+        WRITE_V(0xF);
+        break;
+    case OPCODE_8XY6:
+        emit_alu(bc, 0x89, RAX, VREG(shift_source(inst, target)));
+        emit_alu(bc, 0x89, VREG(x), RAX);
+        emit_shift(bc, 5, VREG(x), 1);
+        emit_alu_imm(bc, 4, RAX, 1);
+        emit_alu(bc, 0x89, VREG(0xF), RAX);
+        WRITE_V(x);
+        WRITE_V(0xF);
+        break;
+    case OPCODE_8XYE:
+        emit_alu(bc, 0x89, RAX, VREG(shift_source(inst, target)));
+        emit_alu(bc, 0x89, VREG(x), RAX);
+        emit_shift(bc, 4, VREG(x), 1);
+        emit_alu_imm(bc, 4, VREG(x), 0xFF);
+        emit_shift(bc, 5, RAX, 7);
+        emit_alu(bc, 0x89, VREG(0xF), RAX);
+        WRITE_V(x);
+        WRITE_V(0xF);
+        break;
+    case OPCODE_ANNN:
+        emit_mov_imm(bc, RCX, inst & 0x0FFF);
+        bc->writes_i = 1;
+        break;
+    case OPCODE_FX07:
+        emit_load_byte(bc, VREG(x), OFFSET_DELAY);
+        WRITE_V(x);
+        break;
+    case OPCODE_FX15:
+        emit_store_byte(bc, VREG(x), OFFSET_DELAY);
+        break;
+    case OPCODE_FX18:
+        emit_store_byte(bc, VREG(x), OFFSET_SOUND);
+        break;
+    case OPCODE_FX1E:
+        emit_alu(bc, 0x01, RCX, VREG(x));
+        emit_alu_imm(bc, 4, RCX, 0xFFFF);
+        bc->writes_i = 1;
+        break;
+    case OPCODE_FX29:
+        emit_lea_times5(bc, VREG(x), SMALL_FONT_ADDRESS);
+        bc->writes_i = 1;
+        break;
+    case OPCODE_FX30:
+        emit_lea_times5(bc, VREG(x), 0);
+        emit_alu(bc, 0x01, RCX, RCX);
+        emit_alu_imm(bc, 0, RCX, BIG_FONT_ADDRESS);
+        bc->writes_i = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+static BYTE *compile_block(Chip8_JIT *jit, Chip8_CPU *cpu, WORD address, BYTE *length)
+{
+    Block_Compiler bc = {0};
+    WORD insts[CHIP8_MAX_BLOCK_LENGTH];
+    Chip8_Opcode opcodes[CHIP8_MAX_BLOCK_LENGTH];
+    BYTE count = 0;
+    WORD pc = address;
+    int ends_block = 0;
+
+    memset(bc.host, -1, sizeof(bc.host));
+
+    while (!ends_block && count < CHIP8_MAX_BLOCK_LENGTH && (uint32_t)pc + 4 < memory_size(cpu))
+    {
+        WORD inst = predecode(cpu, pc)->inst;
+        Chip8_Opcode opcode = decode_opcode(inst);
+        BYTE regs[3];
+
+        if (!translatable(opcode, cpu->target))
+            break;
+        // Idle loops are left to the interpreter, which detects them in OP_1NNN.
+        if (opcode == OPCODE_1NNN && ((inst & 0x0FFF) == pc || is_delay_wait(cpu->game_memory, pc, inst & 0x0FFF)))
+            break;
+        if (!reserve_registers(&bc, regs, registers_used(opcode, inst, cpu->target, regs)))
+            break;
+
+        insts[count] = inst;
+        opcodes[count] = opcode;
+        count++;
+        ends_block = opcode_ends_block(opcode);
+        pc += 2;
+    }
+
+    if (count == 0)
+        return JIT_FAILED;
+
+    if (jit->used + JIT_MAX_BLOCK_CODE > CHIP8_JIT_CODE_SIZE)
+    {
+        // Out of code space: start over, hot blocks get compiled again.
+        memset(jit->native, 0, sizeof(jit->native));
+        memset(jit->hits, 0, sizeof(jit->hits));
+        jit->used = 0;
+    }
+
+    BYTE *entry = jit->code + jit->used;
+    int uses_i = 0;
+    bc.out = entry;
+
+    for (BYTE i = 0; i < count; i++)
+    {
+        if (opcodes[i] == OPCODE_FX1E)
+            uses_i = 1;
+    }
+
+    // Prologue: save the callee-saved registers we use, load V registers and I.
+    for (BYTE i = 0; i < bc.pool_used; i++)
+    {
+        if (is_callee_saved(register_pool[i]))
+            emit_push(&bc, register_pool[i]);
+    }
+    for (BYTE v = 0; v < 16; v++)
+    {
+        if (bc.host[v] >= 0)
+            emit_load_byte(&bc, bc.host[v], OFFSET_V(v));
+    }
+    if (uses_i)
+        emit_load_word(&bc, RCX, OFFSET_I);
+
+    for (BYTE i = 0; i < count; i++)
+        emit_instruction(&bc, opcodes[i], insts[i], address + (i + 1) * 2, cpu->target);
+
+    if (!ends_block)
+        emit_store_word_imm(&bc, OFFSET_PC, pc);
+
+    // Epilogue: write back what changed.
+    for (BYTE v = 0; v < 16; v++)
+    {
+        if (bc.written & (1 << v))
+            emit_store_byte(&bc, bc.host[v], OFFSET_V(v));
+    }
+    if (bc.writes_i)
+        emit_store_word(&bc, RCX, OFFSET_I);
+    for (int i = bc.pool_used - 1; i >= 0; i--)
+    {
+        if (is_callee_saved(register_pool[i]))
+            emit_pop(&bc, register_pool[i]);
+    }
+    emit_byte(&bc, 0xC3);
+
+    jit->used += bc.out - entry;
+    jit->compiled++;
+    *length = count;
+    return entry;
+}
+
+int jit_available(void)
+{
+    return 1;
+}
+
+Chip8_JIT *jit_create(void)
+{
+    Chip8_JIT *jit = calloc(1, sizeof(Chip8_JIT));
+    CPU_ASSERT((jit != NULL), "[ERROR] Can't allocate JIT state.\n");
+
+    jit->code = mmap(NULL, CHIP8_JIT_CODE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    CPU_ASSERT((jit->code != MAP_FAILED), "[ERROR] Can't map JIT code buffer.\n");
+    return jit;
+}
+
+void jit_destroy(Chip8_JIT *jit)
+{
+    if (jit == NULL)
+        return;
+    munmap(jit->code, CHIP8_JIT_CODE_SIZE);
+    free(jit);
+}
+
+uint32_t jit_exec(Chip8_JIT *jit, Chip8_CPU *cpu, uint32_t remaining)
+{
+    WORD pc = cpu->program_counter & (memory_size(cpu) - 1);
+    uint32_t index = pc >> 1;
+
+    if (pc & 1)
+        return 0;
+
+    BYTE *entry = jit->native[index];
+    if (entry == NULL)
+    {
+        if (++jit->hits[index] < CHIP8_JIT_THRESHOLD)
+            return 0;
+
+        // The code buffer is only writable while a block is being emitted.
+        CPU_ASSERT((mprotect(jit->code, CHIP8_JIT_CODE_SIZE, PROT_READ | PROT_WRITE) == 0), "[ERROR] Can't unprotect JIT code buffer.\n");
+        entry = compile_block(jit, cpu, pc, &jit->length[index]);
+        CPU_ASSERT((mprotect(jit->code, CHIP8_JIT_CODE_SIZE, PROT_READ | PROT_EXEC) == 0), "[ERROR] Can't protect JIT code buffer.\n");
+        jit->native[index] = entry;
+    }
+
+    if (entry == JIT_FAILED || jit->length[index] > remaining)
+        return 0;
+
+    union
+    {
+        BYTE *code;
+        Chip8_Native run;
+    } native = {.code = entry};
+
+    native.run(cpu);
+    return jit->length[index];
+}
+
+// Drops native blocks that cover `address`, including failed attempts since the new code may be translatable.
+void jit_invalidate(Chip8_JIT *jit, WORD address)
+{
+    uint32_t index = address >> 1;
+    uint32_t first = (index >= CHIP8_MAX_BLOCK_LENGTH - 1) ? index - (CHIP8_MAX_BLOCK_LENGTH - 1) : 0;
+
+    for (uint32_t i = first; i <= index; i++)
+    {
+        if (jit->native[i] != NULL && (jit->native[i] == JIT_FAILED || i + jit->length[i] > index))
+        {
+            jit->native[i] = NULL;
+            jit->hits[i] = 0;
+        }
+    }
+}
+
+uint32_t jit_compiled_blocks(const Chip8_JIT *jit)
+{
+    return jit->compiled;
+}
+
+#else
+
+int jit_available(void)
+{
+    return 0;
+}
+
+Chip8_JIT *jit_create(void)
+{
+    return NULL;
+}
+
+void jit_destroy(Chip8_JIT *jit)
+{
+    UNUSED(jit);
+}
+
+uint32_t jit_exec(Chip8_JIT *jit, Chip8_CPU *cpu, uint32_t remaining)
+{
+    UNUSED(jit);
+    UNUSED(cpu);
+    UNUSED(remaining);
+    return 0;
+}
+
+void jit_invalidate(Chip8_JIT *jit, WORD address)
+{
+    UNUSED(jit);
+    UNUSED(address);
+}
+
+uint32_t jit_compiled_blocks(const Chip8_JIT *jit)
+{
+    UNUSED(jit);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CHIP8_JIT_H
+#define CHIP8_JIT_H 1
+
+#include "Chip8_CPU.h"
+
+/* Native code backend for hot blocks (Linux x86-64 only). Blocks are compiled
+   once they have been entered CHIP8_JIT_THRESHOLD times and only contain the
+   instructions the backend knows how to translate; the first unsupported
+   instruction ends the block and is left to the interpreter. */
+
+#define CHIP8_JIT_THRESHOLD 16
+#define CHIP8_JIT_CODE_SIZE (4 * 1024 * 1024)
+
+int jit_available(void);
+
+Chip8_JIT *jit_create(void);
+
+void jit_destroy(Chip8_JIT *jit);
+
+// Runs the native block at the current PC if it fits in `remaining`. Returns the number of instructions executed, 0 if none.
+uint32_t jit_exec(Chip8_JIT *jit, Chip8_CPU *cpu, uint32_t remaining);
+
+void jit_invalidate(Chip8_JIT *jit, WORD address);
+
+uint32_t jit_compiled_blocks(const Chip8_JIT *jit);
+
+#endif
@@ -0,0 +1,107 @@
+#include "Chip8_Profile.h"
+
+static int opcode_from_name(const char *name)
+{
+    for (int i = 0; i < OPCODE_COUNT; i++)
+    {
+        if (strcmp(name, opcode_name(i)) == 0)
+            return i;
+    }
+    return -1;
+}
+
+Chip8_Profile *profile_create(void)
+{
+    Chip8_Profile *profile = calloc(1, sizeof(Chip8_Profile));
+    ASSERT((profile != NULL), "[ERROR] Can't allocate execution profile.\n");
+    profile_break(profile);
+    return profile;
+}
+
+void profile_destroy(Chip8_Profile *profile)
+{
+    free(profile);
+}
+
+void profile_record(Chip8_Profile *profile, Chip8_Opcode opcode)
+{
+    int first = profile->history[1];
+    int second = profile->history[0];
+
+    if (second >= 0)
+    {
+        profile->pairs[second][opcode]++;
+        if (first >= 0)
+            profile->triples[first][second][opcode]++;
+    }
+
+    if (opcode_ends_block(opcode))
+    {
+        profile_break(profile);
+    }
+    else
+    {
+        profile->history[1] = second;
+        profile->history[0] = opcode;
+    }
+}
+
+void profile_break(Chip8_Profile *profile)
+{
+    profile->history[0] = -1;
+    profile->history[1] = -1;
+}
+
+int profile_load(Chip8_Profile *profile, FILE *stream)
+{
+    char line[64];
+
+    while (fgets(line, sizeof(line), stream) != NULL)
+    {
+        unsigned long long count;
+        char names[3][8];
+        int opcodes[3];
+
+        if (line[0] == '#' || line[0] == '\n')
+            continue;
+
+        int fields = sscanf(line, "%llu %7s %7s %7s", &count, names[0], names[1], names[2]);
+        if (fields < 3)
+            return 0;
+
+        for (int i = 0; i < fields - 1; i++)
+        {
+            opcodes[i] = opcode_from_name(names[i]);
+            if (opcodes[i] < 0)
+                return 0;
+        }
+
+        if (fields == 3)
+            profile->pairs[opcodes[0]][opcodes[1]] += count;
+        else
+            profile->triples[opcodes[0]][opcodes[1]][opcodes[2]] += count;
+    }
+
+    return 1;
+}
+
+// One sequence per line: "<count> <opcode> <opcode> [<opcode>]".
+void profile_save(const Chip8_Profile *profile, FILE *stream)
+{
+    fputs("# Chip8 fusion profile: <count> <opcode> <opcode> [<opcode>]\n", stream);
+
+    for (int a = 0; a < OPCODE_COUNT; a++)
+    {
+        for (int b = 0; b < OPCODE_COUNT; b++)
+        {
+            if (profile->pairs[a][b] > 0)
+                fprintf(stream, "%llu %s %s\n", (unsigned long long)profile->pairs[a][b], opcode_name(a), opcode_name(b));
+
+            for (int c = 0; c < OPCODE_COUNT; c++)
+            {
+                if (profile->triples[a][b][c] > 0)
+                    fprintf(stream, "%llu %s %s %s\n", (unsigned long long)profile->triples[a][b][c], opcode_name(a), opcode_name(b), opcode_name(c));
+            }
+        }
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef CHIP8_PROFILE_H
+#define CHIP8_PROFILE_H 1
+
+#include "Chip8_CPU.h"
+#include "Chip8_Decode.h"
+
+/* Execution counts of the instruction pairs and triples that can become
+   superinstructions: consecutive instructions where all but the last one
+   stay inside the basic block. Written with -p; the build turns the
+   profile into Chip8_Fusion.h. */
+struct Chip8_Profile
+{
+    uint64_t pairs[OPCODE_COUNT][OPCODE_COUNT];
+    uint64_t triples[OPCODE_COUNT][OPCODE_COUNT][OPCODE_COUNT];
+    int history[2]; // Last two block body opcodes executed, most recent first. -1 if none.
+};
+
+Chip8_Profile *profile_create(void);
+
+void profile_destroy(Chip8_Profile *profile);
+
+void profile_record(Chip8_Profile *profile, Chip8_Opcode opcode);
+
+// Forgets the history, the next instruction does not follow the previous one.
+void profile_break(Chip8_Profile *profile);
+
+// Adds the counts of a profile written by profile_save. Returns 0 on malformed input.
+int profile_load(Chip8_Profile *profile, FILE *stream);
+
+void profile_save(const Chip8_Profile *profile, FILE *stream);
+
+#endif
@@ -0,0 +1,183 @@
+#include "Chip8_Screen.h"
+
+/* Byte expansion table, built at compile time: entry b holds the 8 pixels of
+   b, most significant bit first, one per byte starting at the lowest one. */
+#define EXPAND(b) (((uint64_t)(((b) >> 7) & 1) << 0) | ((uint64_t)(((b) >> 6) & 1) << 8) |   \
+                   ((uint64_t)(((b) >> 5) & 1) << 16) | ((uint64_t)(((b) >> 4) & 1) << 24) | \
+                   ((uint64_t)(((b) >> 3) & 1) << 32) | ((uint64_t)(((b) >> 2) & 1) << 40) | \
+                   ((uint64_t)(((b) >> 1) & 1) << 48) | ((uint64_t)(((b) >> 0) & 1) << 56))
+#define EXPAND4(b) EXPAND(b), EXPAND((b) + 1), EXPAND((b) + 2), EXPAND((b) + 3)
+#define EXPAND16(b) EXPAND4(b), EXPAND4((b) + 4), EXPAND4((b) + 8), EXPAND4((b) + 12)
+#define EXPAND64(b) EXPAND16(b), EXPAND16((b) + 16), EXPAND16((b) + 32), EXPAND16((b) + 48)
+
+static const uint64_t expand_byte[256] = {EXPAND64(0), EXPAND64(64), EXPAND64(128), EXPAND64(192)};
+
+// Colour indices of the 8 pixels in byte `shift` of word `i`, one per byte, first pixel in the lowest.
+static inline uint64_t expand_planes(const uint64_t *const planes[CHIP8_PLANES], int i, int shift)
+{
+    return expand_byte[(planes[0][i] >> shift) & 0xFF] | (expand_byte[(planes[1][i] >> shift) & 0xFF] << 1) |
+           (expand_byte[(planes[2][i] >> shift) & 0xFF] << 2) | (expand_byte[(planes[3][i] >> shift) & 0xFF] << 3);
+}
+
+/* Expands one byte of each plane at a time into 8 colour indices, one per
+   byte of `pixels`, instead of testing every bit on its own. */
+void cpu_to_screen_scalar(const uint64_t *const planes[CHIP8_PLANES], const uint32_t *colors, uint32_t *screen_buffer, int words)
+{
+    for (int i = 0; i < words; i++)
+    {
+        for (int shift = 56; shift >= 0; shift -= 8)
+        {
+            uint64_t pixels = expand_planes(planes, i, shift);
+
+            for (int pixel = 0; pixel < 64; pixel += 8)
+            {
+                *screen_buffer++ = colors[(pixels >> pixel) & 15];
+            }
+        }
+    }
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+#include <immintrin.h>
+
+/* Both vector versions turn the pixels of each plane into lane masks by
+   ANDing the plane bits, broadcast, with the bit of every lane and
+   comparing the result with that bit. SSE2 handles 16 pixels per step
+   (two bytes of each plane) and AVX2 32 (four bytes), one store per 4 or
+   8 lanes. Most ROMs only use the first two planes, and while planes 3
+   and 4 are blank over a step the colour of each lane is picked from the
+   first 4 colours with the two masks. */
+
+// Per lane, `b` where `mask` is set and `a` elsewhere.
+__attribute__((target("sse2"))) static inline __m128i select_sse2(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
+}
+
+/* SSE2 has no gather or variable shuffle. A select tree over all 16
+   colours (15 selects per 4 pixels) measured slower than expanding the
+   bytes with expand_planes, so a step that uses planes 3 or 4 does that. */
+__attribute__((target("sse2"))) static void cpu_to_screen_sse2(const uint64_t *const planes[CHIP8_PLANES], const uint32_t *colors, uint32_t *screen_buffer, int words)
+{
+    const __m128i color0 = _mm_set1_epi32(colors[0]);
+    const __m128i color1 = _mm_set1_epi32(colors[1]);
+    const __m128i color2 = _mm_set1_epi32(colors[2]);
+    const __m128i color3 = _mm_set1_epi32(colors[3]);
+    const __m128i lane_bits[4] = {_mm_setr_epi32(0x8000, 0x4000, 0x2000, 0x1000), _mm_setr_epi32(0x0800, 0x0400, 0x0200, 0x0100),
+                                  _mm_setr_epi32(0x0080, 0x0040, 0x0020, 0x0010), _mm_setr_epi32(0x0008, 0x0004, 0x0002, 0x0001)};
+
+    for (int i = 0; i < words; i++)
+    {
+        uint64_t high_planes = planes[2][i] | planes[3][i];
+
+        for (int shift = 48; shift >= 0; shift -= 16)
+        {
+            if ((high_planes >> shift) & 0xFFFF)
+            {
+                for (int byte = shift + 8; byte >= shift; byte -= 8)
+                {
+                    uint64_t pixels = expand_planes(planes, i, byte);
+
+                    for (int pixel = 0; pixel < 64; pixel += 8)
+                        *screen_buffer++ = colors[(pixels >> pixel) & 15];
+                }
+                continue;
+            }
+
+            __m128i bits1 = _mm_set1_epi32((planes[0][i] >> shift) & 0xFFFF);
+            __m128i bits2 = _mm_set1_epi32((planes[1][i] >> shift) & 0xFFFF);
+
+#pragma GCC unroll 4
+            for (int quarter = 0; quarter < 4; quarter++)
+            {
+                __m128i mask1 = _mm_cmpeq_epi32(_mm_and_si128(bits1, lane_bits[quarter]), lane_bits[quarter]);
+                __m128i mask2 = _mm_cmpeq_epi32(_mm_and_si128(bits2, lane_bits[quarter]), lane_bits[quarter]);
+
+                _mm_storeu_si128((__m128i *)screen_buffer, select_sse2(mask2, select_sse2(mask1, color0, color1), select_sse2(mask1, color2, color3)));
+                screen_buffer += 4;
+            }
+        }
+    }
+}
+
+/* When planes 3 or 4 are set, AVX2 builds each lane's colour index from
+   the plane 1 to 3 masks and looks it up with two 8 entry permutes, one
+   per half of the palette, picking between them with the plane 4 mask.
+   This replaces _mm256_i32gather_epi32, which is slower than the permutes. */
+__attribute__((target("avx2"))) static void cpu_to_screen_avx2(const uint64_t *const planes[CHIP8_PLANES], const uint32_t *colors, uint32_t *screen_buffer, int words)
+{
+    const __m256i color0 = _mm256_set1_epi32(colors[0]);
+    const __m256i color1 = _mm256_set1_epi32(colors[1]);
+    const __m256i color2 = _mm256_set1_epi32(colors[2]);
+    const __m256i color3 = _mm256_set1_epi32(colors[3]);
+    const __m256i low_colors = _mm256_loadu_si256((const __m256i *)colors);
+    const __m256i high_colors = _mm256_loadu_si256((const __m256i *)(colors + 8));
+    __m256i lane_bits[4];
+
+    for (int quarter = 0; quarter < 4; quarter++)
+        lane_bits[quarter] = _mm256_slli_epi32(_mm256_setr_epi32(0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, 0x01), 24 - 8 * quarter);
+
+    for (int i = 0; i < words; i++)
+    {
+        uint64_t high_planes = planes[2][i] | planes[3][i];
+
+        for (int shift = 32; shift >= 0; shift -= 32)
+        {
+            __m256i bits1 = _mm256_set1_epi32((int)(uint32_t)(planes[0][i] >> shift));
+            __m256i bits2 = _mm256_set1_epi32((int)(uint32_t)(planes[1][i] >> shift));
+
+            if ((uint32_t)(high_planes >> shift))
+            {
+                __m256i bits3 = _mm256_set1_epi32((int)(uint32_t)(planes[2][i] >> shift));
+                __m256i bits4 = _mm256_set1_epi32((int)(uint32_t)(planes[3][i] >> shift));
+
+                for (int quarter = 0; quarter < 4; quarter++)
+                {
+                    __m256i mask1 = _mm256_cmpeq_epi32(_mm256_and_si256(bits1, lane_bits[quarter]), lane_bits[quarter]);
+                    __m256i mask2 = _mm256_cmpeq_epi32(_mm256_and_si256(bits2, lane_bits[quarter]), lane_bits[quarter]);
+                    __m256i mask3 = _mm256_cmpeq_epi32(_mm256_and_si256(bits3, lane_bits[quarter]), lane_bits[quarter]);
+                    __m256i mask4 = _mm256_cmpeq_epi32(_mm256_and_si256(bits4, lane_bits[quarter]), lane_bits[quarter]);
+                    __m256i index = _mm256_or_si256(_mm256_and_si256(mask1, _mm256_set1_epi32(1)),
+                                                    _mm256_or_si256(_mm256_and_si256(mask2, _mm256_set1_epi32(2)), _mm256_and_si256(mask3, _mm256_set1_epi32(4))));
+                    __m256i low = _mm256_permutevar8x32_epi32(low_colors, index);
+                    __m256i high = _mm256_permutevar8x32_epi32(high_colors, index);
+
+                    _mm256_storeu_si256((__m256i *)screen_buffer, _mm256_blendv_epi8(low, high, mask4));
+                    screen_buffer += 8;
+                }
+                continue;
+            }
+
+            for (int quarter = 0; quarter < 4; quarter++)
+            {
+                __m256i mask1 = _mm256_cmpeq_epi32(_mm256_and_si256(bits1, lane_bits[quarter]), lane_bits[quarter]);
+                __m256i mask2 = _mm256_cmpeq_epi32(_mm256_and_si256(bits2, lane_bits[quarter]), lane_bits[quarter]);
+                __m256i low = _mm256_blendv_epi8(color0, color1, mask1);
+                __m256i high = _mm256_blendv_epi8(color2, color3, mask1);
+
+                _mm256_storeu_si256((__m256i *)screen_buffer, _mm256_blendv_epi8(low, high, mask2));
+                screen_buffer += 8;
+            }
+        }
+    }
+}
+
+Chip8_Screen_Converter screen_converter(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return cpu_to_screen_avx2;
+    if (__builtin_cpu_supports("sse2"))
+        return cpu_to_screen_sse2;
+    return cpu_to_screen_scalar;
+}
+
+#else
+
+Chip8_Screen_Converter screen_converter(void)
+{
+    return cpu_to_screen_scalar;
+}
+
+#endif
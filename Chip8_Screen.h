@@ -0,0 +1,18 @@
+#ifndef CHIP8_SCREEN_H
+#define CHIP8_SCREEN_H 1
+
+#include "Chip8_CPU.h"
+
+/* Conversion of the first `words` words of each of the CHIP8_PLANES packed
+   screen planes, 64 pixels each, to RGBA8888 pixels. Plane p gives bit p
+   of every pixel's index into the 16 entry `colors` palette. The scalar
+   version is the reference; x86 builds also carry SSE2 and AVX2 versions
+   and screen_converter picks the widest one the CPU supports. */
+
+typedef void (*Chip8_Screen_Converter)(const uint64_t *const planes[CHIP8_PLANES], const uint32_t *colors, uint32_t *screen_buffer, int words);
+
+void cpu_to_screen_scalar(const uint64_t *const planes[CHIP8_PLANES], const uint32_t *colors, uint32_t *screen_buffer, int words);
+
+Chip8_Screen_Converter screen_converter(void);
+
+#endif
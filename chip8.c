@@ -6,9 +6,14 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <setjmp.h>
 
 #include "SDL2/SDL.h"
 #include "Chip8_CPU.h"
+#include "Chip8_JIT.h"
+#include "Chip8_Profile.h"
+#include "Chip8_AOT.h"
+#include "Chip8_Screen.h"
 
 #define FPS_TARGET 60 // Dont change this or cpu timing will get weird.
 
@@ -32,22 +37,69 @@ const struct
 } KEY_MAPPINGS[] = {
     {SDLK_1, 0x1}, {SDLK_2, 0x2}, {SDLK_3, 0x3}, {SDLK_4, 0xC}, {SDLK_q, 0x4}, {SDLK_w, 0x5}, {SDLK_e, 0x6}, {SDLK_r, 0xD}, {SDLK_a, 0x7}, {SDLK_s, 0x8}, {SDLK_d, 0x9}, {SDLK_f, 0xE}, {SDLK_z, 0xA}, {SDLK_x, 0x0}, {SDLK_c, 0xB}, {SDLK_v, 0xF}};
 
-const uint32_t colors[] = {PLANE0, PLANE1, PLANE2, PLANE3};
+/* RGBA8888 colour of every pixel value, bit p set when plane p is. The
+   first 4 are the ones 2 plane ROMs use; -P can replace any of them. */
+uint32_t colors[16] = {PLANE0, PLANE1, PLANE2, PLANE3,
+                       0xFF000000, 0x00FF0000, 0x0000FF00, 0xFFFF0000, 0x00FFFF00, 0xFF800000, 0x80808000, 0x80000000,
+                       0x00800000, 0x00008000, 0x80800000, 0xFFFFFF00};
 
-void key_event_handler(Chip8_CPU *cpu, SDL_Event *event)
+// Reads up to 16 comma separated RRGGBB colours into colors[], from the first on. Returns 0 on malformed input.
+int parse_palette(const char *arg)
 {
-    BYTE value = (event->type == SDL_KEYDOWN) ? 1 : 0;
+    for (int i = 0; i < 16; i++)
+    {
+        char *end;
+        unsigned long rgb = strtoul(arg, &end, 16);
+
+        if (end - arg != 6 || (*end != ',' && *end != '\0'))
+            return 0;
+        colors[i] = (uint32_t)rgb << 8;
+        if (*end == '\0')
+            return 1;
+        arg = end + 1;
+    }
+    return 0;
+}
+
+/* Key state travels from the main thread to the emulator thread as one bit
+   mask, bit N set while key N is held. Only the main thread writes it, so
+   SDL's atomic get/set (full barriers) are enough, and unlike a queue it can
+   never fill up and lose a release. Events are applied between frames, so
+   the mask loses nothing a queue would have kept. */
+typedef struct
+{
+    SDL_atomic_t pressed;
+} KeyState;
 
+void key_event_handler(KeyState *keys, SDL_Event *event)
+{
     for (BYTE i = 0; i < 16; i++)
     {
         if (KEY_MAPPINGS[i].keycode == event->key.keysym.sym)
         {
-            cpu->keys[KEY_MAPPINGS[i].hex_value] = value;
+            int bit = 1 << KEY_MAPPINGS[i].hex_value;
+            int pressed = SDL_AtomicGet(&keys->pressed);
+
+            SDL_AtomicSet(&keys->pressed, (event->type == SDL_KEYDOWN) ? (pressed | bit) : (pressed & ~bit));
             break;
         }
     }
 }
 
+// Hands every key that changed since the last frame to the CPU.
+void apply_key_state(KeyState *keys, Chip8_CPU *cpu)
+{
+    int pressed = SDL_AtomicGet(&keys->pressed);
+
+    for (BYTE key = 0; key < 16; key++)
+    {
+        BYTE down = (pressed >> key) & 1;
+
+        if (cpu->keys[key] != down)
+            cpu_key_event(cpu, key, down);
+    }
+}
+
 // Frame cap from https://github.com/tsoding/sowon/blob/master/main.c
 typedef struct
 {
@@ -86,54 +138,410 @@ void frame_end(FpsDeltaTime *fpsdt)
     }
 }
 
-void cpu_to_screen(BYTE *screen_plane1, BYTE *screen_plane2, uint32_t *screen_buffer)
+/* Snapshot of the screen published by the emulator thread. Rows are stored
+   in display order, already unrolled from the plane origins. */
+typedef struct
+{
+    uint64_t planes[CHIP8_PLANES][CHIP8_SCREEN_HEIGHT * CHIP8_SCREEN_WORDS];
+    Display_Mode mode;
+} Frame;
+
+/* Lock-free triple buffer: the emulator thread fills frames[back] while the
+   main thread reads frames[front], and they trade their frame for the
+   middle one with an atomic swap. FRAME_FRESH is set in `middle` while it
+   holds a frame the reader has not taken yet. */
+#define FRAME_FRESH 4
+
+typedef struct
+{
+    Frame frames[3];
+    int back;            // Owned by the emulator thread.
+    int front;           // Owned by the main thread.
+    SDL_atomic_t middle; // Index of the spare frame, plus FRAME_FRESH.
+} FrameBuffer;
+
+// Copies the screen into the back frame and publishes it. Returns 1 if the reader had taken the previous one.
+int publish_frame(FrameBuffer *buffer, Chip8_CPU *cpu)
+{
+    Frame *frame = &buffer->frames[buffer->back];
+    int words = screen_words(cpu);
+    int previous;
+
+    for (int y = 0; y < screen_height(cpu); y++)
+    {
+        for (int plane = 0; plane < CHIP8_PLANES; plane++)
+            memcpy(&frame->planes[plane][y * words], screen_row(cpu, cpu->screen_planes[plane], cpu->screen_origins[plane], y), words * sizeof(uint64_t));
+    }
+    frame->mode = cpu->mode;
+
+    previous = SDL_AtomicSet(&buffer->middle, buffer->back | FRAME_FRESH);
+    buffer->back = previous & ~FRAME_FRESH;
+
+    cpu->dirty_flag = 0;
+    return !(previous & FRAME_FRESH);
+}
+
+// Returns the newest published frame, or NULL if there is none since the last call.
+const Frame *acquire_frame(FrameBuffer *buffer)
+{
+    if (!(SDL_AtomicGet(&buffer->middle) & FRAME_FRESH))
+        return NULL;
+    buffer->front = SDL_AtomicSet(&buffer->middle, buffer->front) & ~FRAME_FRESH;
+    return &buffer->frames[buffer->front];
+}
+
+// Part of the screen texture in use: lores screens fill the top left 64x32 pixels and the renderer scales them up.
+SDL_Rect screen_area(Display_Mode mode)
+{
+    if (mode == LORES)
+        return (SDL_Rect){0, 0, CHIP8_LORES_WIDTH, CHIP8_LORES_HEIGHT};
+    return (SDL_Rect){0, 0, CHIP8_SCREEN_WIDTH, CHIP8_SCREEN_HEIGHT};
+}
+
+// Whether row `y`, of `words` words, differs in any plane between two frames.
+int row_changed(const Frame *a, const Frame *b, int y, int words)
+{
+    for (int plane = 0; plane < CHIP8_PLANES; plane++)
+    {
+        if (memcmp(&a->planes[plane][y * words], &b->planes[plane][y * words], words * sizeof(uint64_t)) != 0)
+            return 1;
+    }
+    return 0;
+}
+
+/* Converts only the rows of `frame` that differ from `shown`, the last frame
+   uploaded, straight into the locked texture. The main thread may skip
+   frames, so the rows to update are found by comparing both. */
+void update_screen(const Frame *frame, Frame *shown, SDL_Texture *texture, Chip8_Screen_Converter cpu_to_screen)
+{
+    SDL_Rect area = screen_area(frame->mode);
+    int words = area.w / 64;
+    int top = 0;
+    int bottom = area.h;
+    void *pixels;
+    int pitch;
+
+    if (frame->mode == shown->mode)
+    {
+        while (top < bottom && !row_changed(frame, shown, top, words))
+            top++;
+        while (bottom > top && !row_changed(frame, shown, bottom - 1, words))
+            bottom--;
+        if (top == bottom)
+            return;
+    }
+
+    area.y = top;
+    area.h = bottom - top;
+    if (SDL_LockTexture(texture, &area, &pixels, &pitch) != 0)
+        return;
+    // Locked rows are `pitch` bytes apart, which may be more than the row itself.
+    for (int y = top; y < bottom; y++)
+    {
+        const uint64_t *rows[CHIP8_PLANES] = {&frame->planes[0][y * words], &frame->planes[1][y * words], &frame->planes[2][y * words], &frame->planes[3][y * words]};
+
+        cpu_to_screen(rows, colors, pixels, words);
+        pixels = (BYTE *)pixels + pitch;
+    }
+    SDL_UnlockTexture(texture);
+
+    *shown = *frame;
+}
+
+// Shared between the main thread and the emulator thread.
+typedef struct
+{
+    Chip8_CPU *cpu;
+    uint32_t cpf;
+    Uint32 frame_event; // Pushed when a frame is published and the main thread may be waiting for one.
+    SDL_atomic_t running;
+    KeyState keys;
+    FrameBuffer frames;
+} Emulator;
+
+/* cpu_exit jumps back to emulator_thread instead of calling exit() there,
+   which would run the atexit handlers while the main thread still uses SDL. */
+static jmp_buf emulator_exit;
+static int emulator_status;
+
+void stop_emulator(int status)
+{
+    emulator_status = status;
+    longjmp(emulator_exit, 1);
+}
+
+/* Emulator thread: runs the CPU at FPS_TARGET frames per second and publishes
+   a frame whenever the screen changed. Rendering and presenting happen on
+   the main thread, so a slow present never delays emulation. When the CPU
+   ends the program, it asks the main thread to quit and returns the exit
+   status. */
+int emulator_thread(void *data)
+{
+    Emulator *emulator = data;
+    Chip8_CPU *cpu = emulator->cpu;
+    FpsDeltaTime fps_dt = make_fpsdeltatime(FPS_TARGET);
+
+    if (setjmp(emulator_exit) != 0)
+    {
+        SDL_Event event = {.type = SDL_QUIT};
+
+        SDL_AtomicSet(&emulator->running, 0);
+        SDL_PushEvent(&event);
+        return emulator_status;
+    }
+    cpu_exit_handler = stop_emulator;
+
+    while (SDL_AtomicGet(&emulator->running))
+    {
+        frame_start(&fps_dt);
+
+        apply_key_state(&emulator->keys, cpu);
+        run_instructions(cpu, emulator->cpf);
+        update_timers(cpu);
+        if (cpu->dirty_flag && publish_frame(&emulator->frames, cpu))
+        {
+            SDL_Event event = {.type = emulator->frame_event};
+            SDL_PushEvent(&event);
+        }
+
+        frame_end(&fps_dt);
+    }
+    return 0;
+}
+
+// Fusion profile being recorded with -p, saved when the emulator exits.
+Chip8_Profile *profile = NULL;
+const char *profile_path = NULL;
+
+void save_profile(void)
+{
+    FILE *stream = fopen(profile_path, "w");
+    if (stream == NULL)
+    {
+        fprintf(stderr, "[ERROR] Can't write profile \"%s\": %s\n", profile_path, strerror(errno));
+        return;
+    }
+    profile_save(profile, stream);
+    fclose(stream);
+    profile_destroy(profile);
+}
+
+/* Counts are added to those already in the file, so several ROMs can be
+   profiled into the same one. */
+void start_profile(const char *path)
+{
+    FILE *stream = fopen(path, "r");
+
+    profile = profile_create();
+    profile_path = path;
+    if (stream != NULL)
+    {
+        ASSERT((profile_load(profile, stream)), "[ERROR] \"%s\" is not a fusion profile.\n", path);
+        fclose(stream);
+    }
+    atexit(save_profile);
+}
+
+#ifdef CHIP8_AOT
+// Generated by chip8-aot from the ROM and, with -k, from aot_check. Linked in by "make aot".
+extern const Chip8_AOT_Program chip8_aot_program, chip8_aot_check;
+#endif
+
+const char *const engine_names[] = {"Interpreter", "Predecode", "Block", "JIT", "AOT"};
+
+void set_engine(Chip8_CPU *cpu, Chip8_Engine engine)
+{
+    cpu->engine = engine;
+#ifdef CHIP8_AOT
+    if (engine == ENGINE_AOT)
+    {
+        cpu->aot = aot_create(&chip8_aot_program, cpu);
+        if (cpu->aot == NULL)
+            cpu->aot = aot_create(&chip8_aot_check, cpu);
+        ASSERT((cpu->aot != NULL), "[ERROR] The ROM or the target differ from the ones this binary was compiled for.\n");
+    }
+#endif
+}
+
+/* Runs the ROM for `frames` frames without a window or frame cap, for batch
+   jobs. Also the emulator's microbenchmark: with a large -c on a ROM that
+   never idles, the time per instruction is that of the engine's loop. */
+int run_headless(FILE *rom, Target_Platform target, Chip8_Engine engine, uint32_t cpf, uint32_t frames)
+{
+    static Chip8_CPU cpu;
+    Uint64 start;
+    double seconds;
+
+    ASSERT((engine != ENGINE_JIT || jit_available()), "[ERROR] The JIT is not available on this platform.\n");
+
+    init_cpu(&cpu, rom, target);
+    set_engine(&cpu, engine);
+    if (profile_path != NULL)
+    {
+        start_profile(profile_path);
+        cpu.profile = profile;
+    }
+
+    start = SDL_GetPerformanceCounter();
+    for (uint32_t frame = 0; frame < frames; frame++)
+    {
+        run_instructions(&cpu, cpf);
+        update_timers(&cpu);
+    }
+    seconds = (double)(SDL_GetPerformanceCounter() - start) / (double)SDL_GetPerformanceFrequency();
+
+    printf("%u frames: %llu instructions executed, %llu idle cycles skipped.\n", frames,
+           (unsigned long long)cpu.executed_cycles, (unsigned long long)cpu.skipped_cycles);
+    printf("%.1f ms, %.2f ns per instruction.\n", seconds * 1000.0,
+           (cpu.executed_cycles != 0) ? seconds * 1e9 / (double)cpu.executed_cycles : 0.0);
+    free_cpu(&cpu);
+    return EXIT_SUCCESS;
+}
+
+/* CHIP-8 program -V runs before the ROM. A loop over the ANNN;DXYN
+   superinstruction at 0x202 runs until its code is cached and compiled.
+   The program then rewrites the DXYN and, after it, the ANNN to A310, and
+   runs the loop again: every engine must finish with I at 0x310. */
+static const BYTE smc_check[] = {
+    0x61, 0x40, 0xA3, 0x00, 0xD0, 0x05, 0x71, 0xFF, 0x31, 0x00, 0x12, 0x02, // 0x200: loop 0x40 times
+    0x32, 0x01, 0x12, 0x12, 0x12, 0x10,                                     // 0x20C: patch once, then halt
+    0x60, 0xD0, 0x61, 0x05, 0xA2, 0x04, 0xF1, 0x55,                         // 0x212: rewrite DXYN
+    0x60, 0xA3, 0x61, 0x10, 0xA2, 0x02, 0xF1, 0x55,                         // 0x21A: rewrite ANNN
+    0x62, 0x01, 0x61, 0x04, 0x12, 0x02};                                    // 0x222: loop 4 more times
+#define CHECK_FRAMES 100
+#define CHECK_CYCLES 50
+
+/* Runs the ROM headless on the interpreter and on `engine` side by side and
+   compares both CPUs after every frame. No input is fed to either CPU. */
+int verify_engine(FILE *rom, const char *name, Target_Platform target, Chip8_Engine engine, uint32_t cpf, uint32_t frames)
 {
-    for (int i = 0; i < CHIP8_SCREEN_WIDTH * CHIP8_SCREEN_HEIGHT; i++)
+    static Chip8_CPU reference, native;
+
+    ASSERT((engine != ENGINE_JIT || jit_available()), "[ERROR] The JIT is not available on this platform.\n");
+
+    init_cpu(&reference, rom, target);
+    rewind(rom);
+    init_cpu(&native, rom, target);
+    set_engine(&reference, ENGINE_INTERPRETER);
+    set_engine(&native, engine);
+
+    for (uint32_t frame = 0; frame < frames; frame++)
     {
-        screen_buffer[i] = colors[(screen_plane2[i] << 1) | screen_plane1[i]];
+        run_instructions(&reference, cpf);
+        update_timers(&reference);
+        run_instructions(&native, cpf);
+        update_timers(&native);
+
+        if (!cpu_state_equal(&reference, &native))
+        {
+            fprintf(stderr, "[ERROR] %s diverged from the interpreter on %s at frame %u. PC: 0x%04x (interpreter) 0x%04x (%s)\n",
+                    engine_names[engine], name, frame, reference.program_counter, native.program_counter, engine_names[engine]);
+            return EXIT_FAILURE;
+        }
     }
+
+    if (engine == ENGINE_JIT)
+        printf("JIT matches the interpreter on %s after %u frames (%u native blocks compiled).\n", name, frames, jit_compiled_blocks(native.jit));
+    else
+        printf("%s matches the interpreter on %s after %u frames.\n", engine_names[engine], name, frames);
+    free_cpu(&reference);
+    free_cpu(&native);
+    return EXIT_SUCCESS;
 }
 
 int main(int argc, char *argv[])
 {
     int retval;
     int running = 1;
+    int redraw = 1;
+    static Emulator emulator;
+    static Frame shown;
+    SDL_Thread *thread;
 
     SDL_Window *window;
     SDL_Renderer *renderer;
     SDL_Texture *screen_texture;
-    uint32_t *screen_buffer;
+    Chip8_Screen_Converter cpu_to_screen = screen_converter();
     char title[255];
 
     Chip8_CPU cpu = {0};
     Target_Platform target = XOCHIP;
+#ifdef CHIP8_AOT
+    Chip8_Engine engine = ENGINE_AOT;
+    int engine_selected = 1;
+#else
+    Chip8_Engine engine = ENGINE_BLOCK;
+    int engine_selected = 0;
+#endif
     uint32_t cpf = CHIP8_CYCLES_PER_FRAME;
+    uint32_t verify_frames = 0;
+    uint32_t headless_frames = 0;
     const char *filename;
 
     char c;
-    while ((c = getopt(argc, argv, "ht:c:")) != -1)
+    while ((c = getopt(argc, argv, "ht:c:e:V:p:n:P:")) != -1)
     {
         switch (c)
         {
         case 't': // Emulation Target
-            if (strncmp(optarg, "Chip8", strlen(optarg)) == 0)
+            target = parse_target(optarg);
+            break;
+        case 'e': // Execution engine
+            if (strncmp(optarg, "Interpreter", strlen(optarg)) == 0)
+            {
+                engine = ENGINE_INTERPRETER;
+            }
+            else if (strncmp(optarg, "Predecode", strlen(optarg)) == 0)
             {
-                target = CHIP8;
+                engine = ENGINE_PREDECODE;
             }
-            else if (strncmp(optarg, "SuperChip", strlen(optarg)) == 0)
+            else if (strncmp(optarg, "Block", strlen(optarg)) == 0)
             {
-                target = SCHIPC;
+                engine = ENGINE_BLOCK;
             }
-            else if (strncmp(optarg, "XO-Chip", strlen(optarg)) == 0)
+            else if (strncmp(optarg, "JIT", strlen(optarg)) == 0 && jit_available())
             {
-                target = XOCHIP;
+                engine = ENGINE_JIT;
             }
+#ifdef CHIP8_AOT
+            else if (strncmp(optarg, "AOT", strlen(optarg)) == 0)
+            {
+                engine = ENGINE_AOT;
+            }
+#endif
             else
             {
-                fprintf(stderr, "Unknown Chip8 variant '%s'.\nPossible options: Chip8 | SuperChip | XO-Chip \n", optarg);
+                fprintf(stderr, "Unknown engine '%s'.\nPossible options: Interpreter | Predecode | Block | JIT (Linux x86-64 only) | AOT (make aot builds only) \n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            engine_selected = 1;
+            break;
+        case 'V': // JIT verification
+            verify_frames = atoi(optarg);
+            if (verify_frames <= 0)
+            {
+                fputs("-V value must be greater than 0\n", stderr);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'n': // Headless run
+            headless_frames = atoi(optarg);
+            if (headless_frames <= 0)
+            {
+                fputs("-n value must be greater than 0\n", stderr);
                 exit(EXIT_FAILURE);
             }
             break;
+        case 'P': // Palette
+            if (!parse_palette(optarg))
+            {
+                fputs("-P value must be up to 16 comma separated RRGGBB colours\n", stderr);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'p': // Fusion profile
+            profile_path = optarg;
+            break;
         case 'c': // Cycles per frame
             cpf = atoi(optarg);
             if (cpf <= 0)
@@ -160,12 +568,37 @@ int main(int argc, char *argv[])
                 "            Speed you want the emulator to run, measured in\n"
                 "            Cycles per Frame. One cycle equals one instruction.\n"
                 "            Recommended value: 15-30.\n"
+                "    -e <ENGINE>\n"
+                "            Select how instructions are executed.\n"
+                "            Possible engines: Interpreter | Predecode | Block | JIT | AOT.\n"
+                "            JIT is only available on Linux x86-64, AOT only in\n"
+                "            binaries built with make aot.\n"
+                "            Default: Block (AOT in make aot builds).\n"
+                "    -V <FRAMES>\n"
+                "            Run FRAMES frames without a window on both the engine\n"
+                "            selected with -e (JIT if none) and the interpreter\n"
+                "            and check they stay identical, after doing the same\n"
+                "            with a built-in self-modifying code check\n"
+                "            (a check without it under AOT).\n"
+                "    -n <FRAMES>\n"
+                "            Run FRAMES frames as fast as possible without a\n"
+                "            window and print how many instructions ran, how\n"
+                "            many cycles were skipped in idle loops and the time\n"
+                "            taken per instruction.\n"
+                "    -P <COLOURS>\n"
+                "            Palette as up to 16 comma separated RRGGBB colours,\n"
+                "            replacing the default ones from the first on. Colour\n"
+                "            N is used where bit P of N is set on plane P+1.\n"
+                "    -p <FILE>\n"
+                "            Count the instruction sequences that could be fused\n"
+                "            and add them to FILE on exit. The build fuses the\n"
+                "            most frequent ones, see Chip8_Fusion.h.\n"
                 "    -h\n"
                 "            Displays this text.");
                 exit(EXIT_SUCCESS);
             break;
         default:
-            fprintf(stderr, "Usage: %s [-t target] [-c cycles] ROM\n", argv[0]);
+            fprintf(stderr, "Usage: %s [-t target] [-c cycles] [-e engine] [-V frames] [-n frames] [-P palette] [-p profile] ROM\n", argv[0]);
             exit(EXIT_FAILURE);
         }
     }
@@ -182,6 +615,34 @@ int main(int argc, char *argv[])
     FILE *fd = fopen(filename, "rb");
     ASSERT((fd != NULL), "[ERROR] \"%s\" No such file or directory.\n", filename);
 
+    if (verify_frames > 0)
+    {
+        if (!engine_selected)
+            engine = ENGINE_JIT;
+
+        // AOT blocks only exist for the programs they were compiled from, make aot compiles aot_check in.
+        const BYTE *program = (engine == ENGINE_AOT) ? aot_check : smc_check;
+        size_t size = (engine == ENGINE_AOT) ? sizeof(aot_check) : sizeof(smc_check);
+        const char *check_name = (engine == ENGINE_AOT) ? "the AOT check" : "the self-modifying code check";
+        FILE *check = tmpfile();
+        ASSERT((check != NULL && fwrite(program, size, 1, check) == 1), "[ERROR] Can't write %s.\n", check_name);
+        rewind(check);
+
+        retval = verify_engine(check, check_name, CHIP8, engine, CHECK_CYCLES, CHECK_FRAMES);
+        if (retval == EXIT_SUCCESS)
+            retval = verify_engine(fd, filename, target, engine, cpf, verify_frames);
+        fclose(check);
+        fclose(fd);
+        return retval;
+    }
+
+    if (headless_frames > 0)
+    {
+        retval = run_headless(fd, target, engine, cpf, headless_frames);
+        fclose(fd);
+        return retval;
+    }
+
     atexit(SDL_Quit);
     retval = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
     ASSERT((retval == 0), "[ERROR] Can't initialize SDL: %s\n", SDL_GetError());
@@ -199,23 +660,41 @@ int main(int argc, char *argv[])
     screen_texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STREAMING, CHIP8_SCREEN_WIDTH, CHIP8_SCREEN_HEIGHT);
     ASSERT((screen_texture != NULL), "[ERROR] Can't create screen surface: %s\n", SDL_GetError());
 
-    screen_buffer = calloc(CHIP8_SCREEN_HEIGHT * CHIP8_SCREEN_WIDTH, sizeof(uint32_t));
-    ASSERT((screen_buffer != NULL), "[ERROR] Can't allocate space for screen buffer : %s\n", strerror(errno));
-
-    FpsDeltaTime fps_dt = make_fpsdeltatime(FPS_TARGET);
 
     init_cpu(&cpu, fd, target);
+    set_engine(&cpu, engine);
+    if (profile_path != NULL)
+    {
+        start_profile(profile_path);
+        cpu.profile = profile;
+    }
     fclose(fd);
 
     SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
 
+    emulator.cpu = &cpu;
+    emulator.cpf = cpf;
+    emulator.frame_event = SDL_RegisterEvents(1);
+    ASSERT((emulator.frame_event != (Uint32)-1), "[ERROR] Can't register SDL event: %s\n", SDL_GetError());
+    emulator.frames.back = 1;
+    SDL_AtomicSet(&emulator.frames.middle, 2);
+    SDL_AtomicSet(&emulator.running, 1);
+    // The screen before the first frame: lores and blank, with the converter forced to fill it once.
+    shown.mode = HIRES;
+    update_screen(&emulator.frames.frames[0], &shown, screen_texture, cpu_to_screen);
+
+    thread = SDL_CreateThread(emulator_thread, "chip8-emulator", &emulator);
+    ASSERT((thread != NULL), "[ERROR] Can't create emulator thread: %s\n", SDL_GetError());
+
+    // The main thread only handles input and draws the frames the emulator thread publishes.
     while (running)
     {
-        frame_start(&fps_dt);
-
-        // Comienza input
         SDL_Event event = {0};
-        while (SDL_PollEvent(&event))
+        const Frame *frame;
+
+        if (!SDL_WaitEvent(&event))
+            continue;
+        do
         {
             switch (event.type)
             {
@@ -224,28 +703,36 @@ int main(int argc, char *argv[])
                 break;
             case SDL_KEYDOWN:
             case SDL_KEYUP:
-                key_event_handler(&cpu, &event);
+                key_event_handler(&emulator.keys, &event);
+                break;
+            case SDL_WINDOWEVENT:
+                // The window contents may be lost, present the last frame again.
+                if (event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED)
+                    redraw = 1;
                 break;
             }
-        }
-        // Termina input
-        // Ejecuto ciclo
-        run_instructions(&cpu, cpf);
-        update_timers(&cpu);
-        if (cpu.dirty_flag)
+        } while (SDL_PollEvent(&event));
+
+        if ((frame = acquire_frame(&emulator.frames)) != NULL)
         {
-            cpu_to_screen(cpu.screen_plane1, cpu.screen_plane2, screen_buffer);
-            cpu.dirty_flag = 0;
+            update_screen(frame, &shown, screen_texture, cpu_to_screen);
+            redraw = 1;
         }
 
-        // Muestro en pantalla
-        SDL_RenderClear(renderer);
-        SDL_UpdateTexture(screen_texture, NULL, screen_buffer, CHIP8_SCREEN_WIDTH * sizeof(uint32_t));
-        SDL_RenderCopy(renderer, screen_texture, NULL, NULL);
-        SDL_RenderPresent(renderer);
-
-        frame_end(&fps_dt);
+        // Muestro en pantalla, sólo si algo cambió
+        if (redraw)
+        {
+            SDL_RenderClear(renderer);
+            SDL_Rect area = screen_area(shown.mode);
+            SDL_RenderCopy(renderer, screen_texture, &area, NULL);
+            SDL_RenderPresent(renderer);
+            redraw = 0;
+        }
     }
 
+    SDL_AtomicSet(&emulator.running, 0);
+    SDL_WaitThread(thread, &retval);
+    free_cpu(&cpu);
     SDL_Quit();
+    return retval;
 }
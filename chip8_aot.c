@@ -0,0 +1,252 @@
+#define _POSIX_C_SOURCE 2
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#include "Chip8_CPU.h"
+#include "Chip8_Decode.h"
+#include "Chip8_AOT.h"
+
+/* chip8-aot: ahead-of-time compiler from a .ch8 ROM to C. Follows every
+   statically known control flow edge from 0x200 and writes one function per
+   basic block, calling the OP_* handlers of Chip8_Instructions.h with the
+   instruction words as constants. The output links against the emulator
+   core (see "make aot") and runs with -e AOT. */
+
+#define ROM_ADDRESS 0x200
+
+static const char *const target_names[] = {"CHIP8", "SCHIPC", "XOCHIP"};
+
+static BYTE memory[0x10000];
+static BYTE block_start[0x10000];
+// Addresses wrap at the end of the target's memory, 4K or 64K.
+static uint32_t address_space = XOCHIP_MEMSIZE;
+
+static WORD rom_word(uint32_t address)
+{
+    return (memory[address & (address_space - 1)] << 8) | memory[(address + 1) & (address_space - 1)];
+}
+
+static void add_block(WORD *worklist, uint32_t *pending, uint32_t address)
+{
+    address &= address_space - 1;
+    if ((address & 1) || block_start[address])
+        return;
+    block_start[address] = 1;
+    worklist[(*pending)++] = address;
+}
+
+/* Follows one block from `address` and queues its successors. Dynamic
+   targets (00EE, BNNN) are left to the runtime: returns come back to the
+   address after a 2NNN, which is queued here, and BNNN runs interpreted. */
+static void walk_block(WORD *worklist, uint32_t *pending, uint32_t address, Target_Platform target)
+{
+    for (;;)
+    {
+        WORD inst = rom_word(address);
+        Chip8_Opcode opcode = decode_opcode(inst);
+        uint32_t next = address + 2;
+
+        if (!opcode_ends_block(opcode))
+        {
+            if (next >= address_space)
+                return;
+            address = next;
+            continue;
+        }
+
+        switch (opcode)
+        {
+        case OPCODE_1NNN:
+            add_block(worklist, pending, inst & 0x0FFF);
+            break;
+        case OPCODE_2NNN:
+            add_block(worklist, pending, inst & 0x0FFF);
+            add_block(worklist, pending, next);
+            break;
+        case OPCODE_3XNN:
+        case OPCODE_4XNN:
+        case OPCODE_5XY0:
+        case OPCODE_9XY0:
+        case OPCODE_EX9E:
+        case OPCODE_EXA1:
+            add_block(worklist, pending, next);
+            add_block(worklist, pending, next + 2);
+            if (target == XOCHIP && rom_word(next) == 0xF000)
+                add_block(worklist, pending, next + 4);
+            break;
+        case OPCODE_F000:
+            add_block(worklist, pending, next + 2);
+            break;
+        case OPCODE_FX0A:
+            // Waiting for a key re-runs the instruction on its own.
+            add_block(worklist, pending, address);
+            add_block(worklist, pending, next);
+            break;
+        case OPCODE_00EE:
+        case OPCODE_00FD:
+        case OPCODE_BNNN:
+        case OPCODE_NULL:
+            break;
+        default:
+            add_block(worklist, pending, next);
+            break;
+        }
+        return;
+    }
+}
+
+static void emit_block(FILE *out, uint32_t address, WORD *length, uint32_t *end)
+{
+    fprintf(out, "static void block_%04X(Chip8_CPU *cpu)\n{\n", address);
+    *length = 0;
+
+    for (;;)
+    {
+        WORD inst = rom_word(address);
+        Chip8_Opcode opcode = decode_opcode(inst);
+        uint32_t next = address + ((opcode == OPCODE_F000) ? 4 : 2);
+
+        fprintf(out, "    cpu->program_counter = 0x%04X;\n", (address + 2) & (address_space - 1));
+        fprintf(out, "    OP_%s(cpu, 0x%04X);\n", opcode_name(opcode), inst);
+        (*length)++;
+
+        if (opcode_ends_block(opcode) || next >= address_space)
+        {
+            *end = next;
+            break;
+        }
+        address = next;
+    }
+
+    fputs("}\n\n", out);
+}
+
+int main(int argc, char *argv[])
+{
+    static WORD worklist[0x8000];
+    uint32_t pending = 0;
+    Target_Platform target = XOCHIP;
+    const char *output = NULL;
+    const char *program = "chip8_aot_program";
+    const char *filename;
+    size_t rom_size;
+    int check = 0;
+    int c;
+
+    while ((c = getopt(argc, argv, "ht:o:k")) != -1)
+    {
+        switch (c)
+        {
+        case 't': // Emulation Target
+            target = parse_target(optarg);
+            break;
+        case 'o': // Output file
+            output = optarg;
+            break;
+        case 'k': // Check program
+            check = 1;
+            break;
+        case 'h': // Help
+            puts("Compiles a Chip 8 ROM to C ahead of time.\n"
+                "\n"
+                "Usage:\n"
+                "    chip8-aot [OPTIONS] rom_filepath\n"
+                "\n"
+                "OPTIONS:\n"
+                "    -t <TARGET>\n"
+                "            Variant the ROM runs on, it must match the one\n"
+                "            given to the emulator. Possible targets:\n"
+                "            Chip8 | SuperChip | XO-Chip. Default: XO-Chip.\n"
+                "    -o <FILE>\n"
+                "            Write the C code to FILE instead of stdout.\n"
+                "    -k\n"
+                "            Compile the CHIP-8 program chip8-rom -V checks first\n"
+                "            instead of a ROM, as chip8_aot_check.\n"
+                "    -h\n"
+                "            Displays this text.");
+            exit(EXIT_SUCCESS);
+            break;
+        default:
+            fprintf(stderr, "Usage: %s [-t target] [-o output] ROM | %s -k [-o output]\n", argv[0], argv[0]);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (check)
+    {
+        target = CHIP8;
+        program = "chip8_aot_check";
+        filename = "the built-in check program";
+        rom_size = sizeof(aot_check);
+        memcpy(&memory[ROM_ADDRESS], aot_check, rom_size);
+        address_space = CHIP8_MEMSIZE;
+    }
+    else
+    {
+        if (optind >= argc)
+        {
+            fputs("Missing ROM filepath\n", stderr);
+            exit(EXIT_FAILURE);
+        }
+
+        address_space = (target == XOCHIP) ? XOCHIP_MEMSIZE : CHIP8_MEMSIZE;
+        filename = argv[optind];
+        FILE *fd = fopen(filename, "rb");
+        ASSERT((fd != NULL), "[ERROR] \"%s\" No such file or directory.\n", filename);
+        rom_size = fread(&memory[ROM_ADDRESS], sizeof(BYTE), address_space - ROM_ADDRESS, fd);
+        fclose(fd);
+    }
+
+    FILE *out = (output != NULL) ? fopen(output, "w") : stdout;
+    ASSERT((out != NULL), "[ERROR] Can't create \"%s\": %s\n", output, strerror(errno));
+
+    add_block(worklist, &pending, ROM_ADDRESS);
+    while (pending > 0)
+    {
+        pending--;
+        walk_block(worklist, &pending, worklist[pending], target);
+    }
+
+    fprintf(out, "// Generated by chip8-aot from %s, do not edit.\n\n", filename);
+    fprintf(out, "#define CHIP8_SPECIALIZED_TARGET %s\n\n", target_names[target]);
+    fputs("#include \"Chip8_AOT.h\"\n#include \"Chip8_Instructions.h\"\n\n", out);
+
+    fputs("static const BYTE rom[] = {", out);
+    for (size_t i = 0; i < rom_size; i++)
+        fprintf(out, "%s0x%02X,", (i % 16 == 0) ? "\n    " : " ", memory[ROM_ADDRESS + i]);
+    fputs("\n};\n\n", out);
+
+    static WORD lengths[0x8000];
+    static uint32_t ends[0x8000];
+    uint32_t block_count = 0;
+
+    for (uint32_t address = 0; address < address_space; address += 2)
+    {
+        if (block_start[address])
+            emit_block(out, address, &lengths[address >> 1], &ends[address >> 1]);
+    }
+
+    fputs("static const Chip8_AOT_Block blocks[] = {\n", out);
+    for (uint32_t address = 0; address < address_space; address += 2)
+    {
+        if (block_start[address])
+        {
+            fprintf(out, "    {0x%04X, %u, 0x%05X, block_%04X},\n", address, lengths[address >> 1], ends[address >> 1], address);
+            block_count++;
+        }
+    }
+    fputs("};\n\n", out);
+
+    fprintf(out, "const Chip8_AOT_Program %s = {%s, rom, sizeof(rom), blocks, %u};\n", program, target_names[target], block_count);
+
+    if (out != stdout)
+        fclose(out);
+
+    fprintf(stderr, "%s: %u blocks\n", filename, block_count);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+
+#include "Chip8_CPU.h"
+#include "Chip8_Decode.h"
+
+/* chip8-dispatch: writes the flat dispatch table used by DISPATCH=table, one
+   handler for each of the 65536 instruction words, resolved with the decode
+   rules of Chip8_Decode.h. Invalid encodings map straight to OP_NULL. */
+
+#define ENTRIES_PER_LINE 8
+
+int main(int argc, char *argv[])
+{
+    FILE *out = (argc > 1) ? fopen(argv[1], "w") : stdout;
+    ASSERT((out != NULL), "[ERROR] Can't create \"%s\": %s\n", argv[1], strerror(errno));
+
+    fputs("#ifndef CHIP8_DISPATCH_H\n#define CHIP8_DISPATCH_H 1\n\n", out);
+    fputs("// Generated by chip8-dispatch, do not edit.\n\n", out);
+    fputs("static void (*const dispatch_table[0x10000])(Chip8_CPU *, WORD) = {\n", out);
+
+    for (uint32_t inst = 0; inst < 0x10000; inst++)
+    {
+        if (inst % ENTRIES_PER_LINE == 0)
+            fprintf(out, "    /* %04X */", inst);
+        fprintf(out, " dispatch_%s,", opcode_name(decode_opcode(inst)));
+        if (inst % ENTRIES_PER_LINE == ENTRIES_PER_LINE - 1)
+            fputc('\n', out);
+    }
+
+    fputs("};\n\n#endif\n", out);
+
+    if (out != stdout)
+        fclose(out);
+    return EXIT_SUCCESS;
+}